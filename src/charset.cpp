@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#include "charset.h"
+
+namespace {
+#include "charmap.h"
+
+  // charsets decoded without the OS.
+  enum { OTHER, SBCS, SJIS, EUCJP, JIS };
+
+  // modes of ISO-2022-JP, which are kept between the encoded words.
+  enum { ASCII, JISX0208, JISX0212, KATAKANA };
+
+  void
+  utf8(std::string& s, unsigned u)
+  {
+    // append the character in UTF-8, and U+FFFD for undefined.
+    if (!u) u = 0xfffd;
+    if (u < 0x80) {
+      s += char(u);
+    } else if (u < 0x800) {
+      s += char(0xc0 | u >> 6), s += char(0x80 | (u & 0x3f));
+    } else {
+      s += char(0xe0 | u >> 12), s += char(0x80 | (u >> 6 & 0x3f)), s += char(0x80 | (u & 0x3f));
+    }
+  }
+
+  unsigned
+  jisx0208(unsigned row, unsigned cell) noexcept
+  {
+    // row 95-114 is the private use area of Shift_JIS 0xF040-0xF9FC.
+    if (row < 94) return jis[row][cell];
+    if (row < 114) return 0xe000 + (row - 94) * 94 + cell;
+    return row < 120 ? jis[row - 20][cell] : 0;
+  }
+
+  size_t
+  sjis(std::string_view t, std::string& s)
+  {
+    size_t i = 0;
+    for (; i < t.size(); ++i) {
+      unsigned c = t[i] & 255;
+      if (c < 0x80) {
+	s += char(c);
+      } else if (c >= 0xa1 && c <= 0xdf) {
+	utf8(s, 0xff61 + c - 0xa1);
+      } else if ((c >= 0x81 && c <= 0x9f) || (c >= 0xe0 && c <= 0xfc)) {
+	if (i + 1 == t.size()) break; // continued to the following text.
+	unsigned d = t[i + 1] & 255;
+	if (d < 0x40 || d > 0xfc || d == 0x7f) {
+	  utf8(s, 0);
+	  continue;
+	}
+	auto row = (c - (c <= 0x9f ? 0x81 : 0xc1)) * 2 + (d >= 0x9f);
+	auto cell = d - (d >= 0x9f ? 0x9f : d >= 0x80 ? 0x41 : 0x40);
+	utf8(s, jisx0208(row, cell)), ++i;
+      } else {
+	utf8(s, c == 0x80 ? 0x80 : c == 0xa0 ? 0xf8f0 : 0xf8f1 + c - 0xfd);
+      }
+    }
+    return i;
+  }
+
+  size_t
+  eucjp(std::string_view t, std::string& s)
+  {
+    size_t i = 0;
+    for (; i < t.size(); ++i) {
+      unsigned c = t[i] & 255;
+      if (c < 0x80) {
+	s += char(c);
+	continue;
+      }
+      auto n = c == 0x8f ? 3U : c == 0x8e || (c >= 0xa1 && c <= 0xfe) ? 2U : 1U;
+      if (n == 1) {
+	utf8(s, 0);
+	continue;
+      }
+      if (i + n > t.size()) break; // continued to the following text.
+      unsigned d = t[i + 1] & 255;
+      if (d < 0xa1 || d > 0xfe) {
+	utf8(s, 0);
+	continue;
+      }
+      if (c == 0x8e) utf8(s, d <= 0xdf ? 0xff61 + d - 0xa1 : 0);
+      else utf8(s, c != 0x8f ? jisx0208(c - 0xa1, d - 0xa1) : 0); // no JIS X 0212.
+      i += n - 1;
+    }
+    return i;
+  }
+
+  size_t
+  iso2022jp(std::string_view t, std::string& s, unsigned& mode)
+  {
+    static constexpr struct { std::string_view seq; unsigned mode; } designations[] = {
+      { "\033(B", ASCII }, { "\033(J", ASCII }, { "\033(I", KATAKANA },
+      { "\033$@", JISX0208 }, { "\033$B", JISX0208 }, { "\033$(D", JISX0212 },
+    };
+    size_t i = 0;
+    while (i < t.size()) {
+      unsigned c = t[i] & 255;
+      if (c == 0x1b) {
+	auto const esc = t.substr(i);
+	auto designated = false, partial = false;
+	for (auto const& d : designations) {
+	  if (esc.starts_with(d.seq)) {
+	    mode = d.mode, i += d.seq.size(), designated = true;
+	    break;
+	  }
+	  partial = partial || d.seq.starts_with(esc);
+	}
+	if (designated) continue;
+	if (partial) break; // continued to the following text.
+	utf8(s, 0), ++i;
+	continue;
+      }
+      ++i;
+      if (c == 0x0e || c == 0x0f) {
+	mode = c == 0x0e ? KATAKANA : ASCII;
+      } else if (c >= 0x80) {
+	utf8(s, c >= 0xa1 && c <= 0xdf ? 0xff61 + c - 0xa1 : 0);
+      } else if (c <= 0x20 || c == 0x7f || mode == ASCII) {
+	s += char(c);
+      } else if (mode == KATAKANA) {
+	utf8(s, c <= 0x5f ? 0xff61 + c - 0x21 : 0);
+      } else if (i == t.size()) {
+	--i;
+	break; // continued to the following text.
+      } else if (unsigned d = t[i] & 255; d < 0x21 || d > 0x7e) {
+	utf8(s, 0);
+      } else {
+	utf8(s, mode == JISX0208 ? jisx0208(c - 0x21, d - 0x21) : 0);
+	++i;
+      }
+    }
+    return i;
+  }
+}
+
+bool
+u8decode(unsigned codepage, std::string_view text, std::string& result, unsigned long& mode)
+{
+  // decode the text into UTF-8 for the common charsets of mails.
+  // The mode has the state of ISO-2022-JP in the low 8 bits, and the
+  // bytes left undecoded for the following text in the others.
+  auto type = OTHER;
+  unsigned short const* map = {};
+  switch (codepage) {
+  case 20127: case 28591: type = SBCS; break;
+  case 932: type = SJIS; break;
+  case 51932: type = EUCJP; break; // 20932 has JIS X 0212 by the OS.
+  case 50220: case 50221: case 50222: type = JIS; break;
+  case 38598: codepage = 28598; [[fallthrough]];
+  default:
+    for (auto const& t : sbcs) {
+      if (t.codepage == codepage) type = SBCS, map = t.map;
+    }
+    break;
+  }
+  // the text of ASCII needs no conversion in the charsets compatible with ASCII.
+  if (!mode && (type != OTHER || codepage == 874 || (codepage >= 1250 && codepage <= 1258) ||
+		codepage == 936 || codepage == 949 || codepage == 950 || codepage == 20932 ||
+		codepage == 51936 || codepage == 51949 || codepage == 54936)) {
+    auto ascii = true;
+    for (auto c : text) {
+      if (c & 0x80 || c == 0x1b || c == 0x0e || c == 0x0f) {
+	ascii = false;
+	break;
+      }
+    }
+    if (ascii) return result.assign(text), true;
+  }
+  if (type == OTHER) return false;
+
+  std::string joined;
+  if (mode >> 8) {
+    for (auto left = mode >> 8; left; left >>= 8) joined += char(left & 255);
+    text = joined.append(text);
+  }
+  result.clear();
+  result.reserve(text.size() * 3 / 2 + 3);
+  auto state = unsigned(mode & 255);
+  size_t n = text.size();
+  switch (type) {
+  case SBCS:
+    for (auto c : text) {
+      if (!(c & 0x80)) result += c;
+      else if (!map && codepage == 20127) result += char(c & 0x7f); // as Windows does.
+      else utf8(result, map ? map[c & 127] : c & 255);
+    }
+    break;
+  case SJIS: n = sjis(text, result); break;
+  case EUCJP: n = eucjp(text, result); break;
+  case JIS: n = iso2022jp(text, result, state); break;
+  case OTHER: break;
+  }
+  unsigned long left = 0; // 3 bytes at most.
+  for (auto i = text.size(); i-- > n;) left = left << 8 | (text[i] & 255);
+  mode = state | left << 8;
+  return true;
+}
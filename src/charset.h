@@ -0,0 +1,18 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// codepage - the code page of the charset name, or 0 if it's unknown.
+extern unsigned codepage(std::string_view charset);
+
+// u8decode - decode the text into UTF-8 without the OS, or return false
+// if the code page is left to the OS. The mode is carried over between
+// the texts, such as the encoded words of a header.
+extern bool u8decode(unsigned codepage, std::string_view text, std::string& result, unsigned long& mode);
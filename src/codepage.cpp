@@ -4,141 +4,141 @@
  * This software comes with ABSOLUTELY NO WARRANTY; for details of
  * the license terms, see the LICENSE.txt file included with the program.
  */
-#include <string>
-#include <cstdio>
-#include <cstdlib>
+#include "charset.h"
+#include <charconv>
+#include <iterator>
+#include <string_view>
 
-/** crc32 - CRC32 calculator
- */
 namespace {
-  class crc32 {
-    unsigned _tab[256];
+#include "codepage.h"
+
+  constexpr char
+  fold(char c) noexcept
+  {
+    return c >= 'a' && c <= 'z' ? char(c - ('a' - 'A')) : c;
+  }
+
+  // hash - FNV-1a hash of the charset name ignoring the case.
+  constexpr unsigned
+  hash(std::string_view s) noexcept
+  {
+    auto v = 2166136261U;
+    for (auto c : s) v = (v ^ (fold(c) & 255U)) * 16777619U;
+    return v;
+  }
+
+  constexpr bool
+  equal(std::string_view s, std::string_view upper) noexcept
+  {
+    if (s.size() != upper.size()) return false;
+    for (size_t i = 0; i < s.size(); ++i) {
+      if (fold(s[i]) != upper[i]) return false;
+    }
+    return true;
+  }
+
+  /** table - hash table of the aliases built at compile time.
+   * The table is open-addressed by the hash ignoring the case, so the
+   * charset name is looked up without converting it.
+   */
+  class table {
+    static constexpr unsigned _size = 1024; // more than twice of the aliases.
+    unsigned short _slot[_size];            // index of aliases + 1, or 0.
+    unsigned _probe = 0;                    // the longest probe.
   public:
-    crc32() noexcept {
-      for (unsigned i = 0; i < 256; ++i) {
-	auto v = i;
-	for (int c = 8; c--;) {
-	  v = ((int(!(v & 1)) - 1) & 0xedb88320) ^ (v >> 1);
+    constexpr table() : _slot() {
+      static_assert(std::size(aliases) * 2 < _size);
+      for (unsigned i = 0; i < std::size(aliases); ++i) {
+	for (auto n = 0U, h = hash(aliases[i].name);; ++n, ++h) {
+	  auto& slot = _slot[h & (_size - 1)];
+	  if (!slot) {
+	    slot = static_cast<unsigned short>(i + 1);
+	    if (n > _probe) _probe = n;
+	    break;
+	  }
+	  if (equal(aliases[slot - 1].name, aliases[i].name)) break; // the first one is taken.
 	}
-	_tab[i] = v;
       }
     }
-    unsigned operator()(std::string_view s) const noexcept {
-      auto v = ~0U;
-      for (auto c : s) v = _tab[(v ^ c) & 255] ^ (v >> 8);
-      return ~v;
+    unsigned operator()(std::string_view cs) const noexcept {
+      for (auto n = 0U, h = hash(cs); n <= _probe; ++n, ++h) {
+	auto const slot = _slot[h & (_size - 1)];
+	if (!slot) break;
+	if (equal(cs, aliases[slot - 1].name)) return aliases[slot - 1].codepage;
+      }
+      return 0;
     }
+    constexpr unsigned probe() const noexcept { return _probe; }
   };
-  crc32 const crc;
+  constexpr table lookup;
+  static_assert(lookup.probe() < 8);
+}
+
+unsigned
+codepage(std::string_view charset)
+{
+  if (charset.empty()) return 0;
+  if (auto cp = lookup(charset); cp) return cp;
+  if (auto i = charset.find_last_not_of("0123456789"); i < charset.size() - 1) {
+    auto prefix = charset.substr(0, i + 1);
+    for (auto t : { "WINDOWS-", "CP", "X-CP" }) {
+      if (!equal(prefix, t)) continue;
+      unsigned long cp = 0;
+      std::from_chars(charset.data() + i + 1, charset.data() + charset.size(), cp);
+      return cp;
+    }
+  }
+  return 0;
 }
 
 #if MAIN
 
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
-#include <iomanip>
-#include <list>
-
-namespace {
-  struct elem {
-    unsigned hash;
-    unsigned cp;
-    std::string cs;
-    elem() {}
-    elem(unsigned hash, unsigned cp, std::string const& cs) : hash(hash), cp(cp), cs(cs) {}
-  };
-}
+#include <string>
 
 int
-main()
+main(int argc, char** argv)
 {
-  constexpr char ws[] = "\t ";
-  std::list<elem> ls;
-  while (std::cin) {
+  // verify the aliases in codepage.txt given as the argument or from the
+  // standard input, and that the table has no other aliases.
+  constexpr char ws[] = "\t \r";
+  std::ifstream file;
+  if (argc > 1) file.open(argv[1]);
+  auto& in = argc > 1 ? file : std::cin;
+  if (!in) {
+    std::cerr << argv[1] << ": cannot open" << std::endl;
+    return 1;
+  }
+  auto errors = 0;
+  size_t count = 0;
+  while (in) {
     std::string s;
-    getline(std::cin, s);
+    getline(in, s);
     auto i = s.find(';');
     if (i != s.npos) s.erase(i);
     i = s.find_first_not_of(ws);
     if (i == s.npos) continue;
     auto n = s.find_first_not_of("0123456789", i);
     if (n == s.npos || n == i) continue;
-    std::string cp(s, i, n - i);
+    auto cp = strtoul(s.c_str() + i, {}, 10);
     i = s.find_first_not_of(ws, n);
     if (i == s.npos || i == n) continue;
     n = s.find_first_of(ws, i);
-    std::string cs(s, i, n - i);
-    for (auto& c : cs) c = static_cast<char>(std::toupper(c));
-    auto hash = crc(cs);
-    auto const end = ls.end();
-    auto p = ls.begin();
-    while (p != end && hash > p->hash) ++p;
-    if (p == end || p->hash != hash) {
-      ls.insert(p, elem(hash, strtoul(cp.c_str(), {}, 10), cs));
-    } else {
-      std::cerr << "conflict: " << cs << "(" << cp << ") and "
-		<< p->cs << "(" << p->cp << ")" << std::endl;
-    }
-  }
-  for (int cp = 1; cp < 65536; ++cp) {
-    char no[10];
-    sprintf(no, "%d", cp);
-    constexpr char const* prefix[] { "WINDOWS-", "X-CP", "CP", "CP0", "CP00" };
-    int i = sizeof(prefix) / sizeof(prefix[0]);
-    i -= (cp >= 1000) + (cp >= 10000);
-    while (i--) {
-      auto cs = std::string(prefix[i]) + no;
-      auto hash = crc(cs);
-      for (auto const& t : ls) {
-	if (hash > t.hash) continue;
-	if (hash == t.hash && cs != t.cs) {
-	  std::cerr << "conflict: " << cs << "(" << cp << ") and "
-		    << t.cs << "(" << t.cp << ")" << std::endl;
-	}
-	break;
-      }
+    auto cs = s.substr(i, n - i);
+    ++count;
+    if (auto found = codepage(cs); found != cp) {
+      std::cerr << cs << ": " << found << " instead of " << cp << std::endl;
+      ++errors;
     }
   }
-  std::cout << "// This file was created by codepage.exe." << std::endl
-	    << std::endl
-	    << "constexpr unsigned hash[] = {" << std::endl
-	    << std::hex << std::setfill('0');
-  for (auto& t : ls) {
-    std::cout << "  0x" << std::setw(8) << t.hash << ",\t// " << t.cs << std::endl;
-  }
-  std::cout << "};" << std::endl
-	    << std::endl
-	    << "constexpr unsigned short codepage[] = {" << std::endl
-	    << std::dec << std::setfill(' ');
-  for (auto& t : ls) {
-    std::cout << "    " << std::setw(8) << t.cp << ",\t// " << t.cs << std::endl;
-  }
-  std::cout << "};" << std::endl;
-  return 0;
-}
-
-#else
-
-unsigned
-codepage(std::string_view charset)
-{
-#include "codepage.h"
-  if (charset.empty()) return 0;
-  auto cs = std::string(charset);
-  for (auto& c : cs) c = static_cast<char>(std::toupper(c));
-  auto const k = crc(cs);
-  for (size_t lo = 0, hi = sizeof(hash) / sizeof(hash[0]); lo < hi;) {
-    auto i = (lo + hi) >> 1;
-    if (auto diff = int(k - hash[i]); !diff) return codepage[i];
-    else if (diff < 0) hi = i;
-    else lo = i + 1;
-  }
-  if (auto i = cs.find_last_not_of("0123456789"); i < cs.size() - 1) {
-    auto prefix = std::string_view(cs).substr(0, i + 1);
-    for (auto t : { "WINDOWS-", "CP", "X-CP" }) {
-      if (t == prefix) return strtoul(cs.c_str() + i + 1, {}, 10);
-    }
+  if (count != std::size(aliases)) {
+    std::cerr << count << " aliases instead of " << std::size(aliases) << std::endl;
+    ++errors;
   }
-  return 0;
+  std::cout << "probe: " << lookup.probe() << std::endl;
+  return errors != 0;
 }
 
 #endif
@@ -1,709 +1,360 @@
-// This file was created by codepage.exe.
+// The aliases of the charsets in codepage.txt, and their code pages.
+// Keep this table in sync with codepage.txt, which is verified by
+// codepage.cpp compiled with MAIN as: codepage.exe codepage.txt
 
-constexpr unsigned hash[] = {
-  0x0058cea8,	// GREEK8
-  0x0084bfe3,	// ISO-8859-4
-  0x0157ce9a,	// GB18030
-  0x02e99d0b,	// ISO_8859-8:1988
-  0x03207447,	// 869
-  0x038e72f9,	// EBCDIC-CP-ROECE
-  0x03b8a396,	// CP284
-  0x04b6b4ca,	// CSISOLATIN4
-  0x04d5678f,	// CP280
-  0x0595734b,	// DIN_66003
-  0x05c2025c,	// ISO_8859-9
-  0x05f0b595,	// CP367
-  0x060a3245,	// X-MAC-THAI
-  0x06e886e4,	// X-ISCII-KA
-  0x06eef455,	// CSISOLATINCYRILLIC
-  0x06f45280,	// CYRILLIC
-  0x07c0b830,	// ISO-IR-101
-  0x091b3002,	// ISO-IR-109
-  0x0932f3c8,	// ISO-8859-8
-  0x0942e259,	// CP880
-  0x09a563f7,	// ISO646-SE
-  0x09e750ea,	// IBM500
-  0x0a96386c,	// 865
-  0x0b198a6e,	// ISO_8859-1
-  0x0c22c373,	// IBM855
-  0x0c26e761,	// ISO646-DE
-  0x0c744e77,	// ISO_8859-5
-  0x0dfbfc75,	// 861
-  0x0e813c50,	// UTF-8
-  0x0f0db6a0,	// CSPC862LATINHEBREW
-  0x0fbe1f26,	// X-ISCII-AS
-  0x10300fa1,	// EXTENDED_UNIX_CODE_PACKED_FORMAT_FOR_JAPANESE
-  0x115815ef,	// CSIBM905
-  0x1224e47c,	// IBM01145
-  0x13c689bb,	// ISO-IR-144
-  0x1459c52f,	// EBCDIC-CP-CH
-  0x15492065,	// IBM01141
-  0x161ce6f5,	// ISO646-NO
-  0x173bfb6d,	// CSEUCPKDFMTJAPANESE
-  0x182f7d1e,	// JOHAB
-  0x18b4e68f,	// CP-GR
-  0x1a442afa,	// CP273
-  0x1a70c590,	// ISO-IR-148
-  0x1b704a71,	// WINDOWS-31J
-  0x1b92a857,	// IBM01149
-  0x1cd45b4e,	// ISO-2022-JP
-  0x1dce56ce,	// CP290
-  0x1e2901fc,	// EBCDIC-CP-FI
-  0x1eaae9c5,	// CCSID00858
-  0x1f939f33,	// X-MAC-CHINESESIMP
-  0x202aabc3,	// EBCDIC-CP-SE
-  0x206254a9,	// IBM861
-  0x206399ff,	// CCSID01147
-  0x206e6eb6,	// X-MAC-TURKISH
-  0x21bb6baf,	// 855
-  0x22c1206b,	// CSIBM297
-  0x2458706a,	// X-MAC-CHINESETRAD
-  0x25fc7007,	// CSPC775BALTIC
-  0x266e1849,	// ASCII
-  0x27042cca,	// X-MAC-JAPANESE
-  0x270e5de6,	// CCSID01143
-  0x270f90b0,	// IBM865
-  0x27929ca7,	// X-CHINESE_CNS
-  0x28273992,	// EBCDIC-SE-278+EURO
-  0x29a64da3,	// ISO-8859-13
-  0x2cfd1074,	// CSIBM278
-  0x2eb07e7b,	// ISO_8859-15
-  0x2eb9dc9b,	// IBM869
-  0x2ef64e35,	// EBCDIC-CP-WT
-  0x2fb11d90,	// CSIBM870
-  0x3178feb1,	// EUC-KR
-  0x31a7285d,	// US-ASCII
-  0x31c207fc,	// LATIN2
-  0x31c7e8c8,	// CSIBM864
-  0x33cda3fc,	// ISO_8859-2:1987
-  0x3548e6cc,	// IBM775
-  0x355b1b81,	// CSIBMTHAI
-  0x36aa2cd1,	// CSIBM860
-  0x3719dd64,	// ISO-2022-CN
-  0x37a6c9c8,	// ISO646-FI
-  0x37f11f0c,	// ECMA-114
-  0x397965e8,	// IBM871
-  0x3a13585f,	// IBM420
-  0x3ca1e643,	// L4
-  0x3d7e9c46,	// IBM424
-  0x3e475327,	// ECMA-118
-  0x3f932ec1,	// EBCDIC-CP-NO
-  0x40756abc,	// EBCDIC-DK-277+EURO
-  0x40ac75d8,	// MACINTOSH
-  0x41ad1c47,	// CSIBM861
-  0x430e6885,	// IBM297
-  0x434f95a4,	// X-EUROPA
-  0x44604c22,	// CSISO60DANISHNORWEGIAN
-  0x4565e638,	// X-MAC-CROATIAN
-  0x46c0d85e,	// CSIBM865
-  0x46c5376a,	// LATIN3
-  0x4843eb9f,	// CSPCP852
-  0x496446f6,	// ISO-8859-8-I
-  0x4b46e92c,	// MS_KANJI
-  0x4ba6d6d5,	// L5
-  0x4ccb12cc,	// L1
-  0x4d32589a,	// IBM278
-  0x4de4dd0e,	// CSPC8CODEPAGE437
-  0x4e7e557e,	// IBM870
-  0x4ea61382,	// UTF-32BE
-  0x4f769475,	// CSIBM869
-  0x5008a026,	// IBM864
-  0x50096d70,	// CCSID01142
-  0x50b22162,	// X-ISCII-MA
-  0x51d19f20,	// 850
-  0x52758691,	// CP00924
-  0x541ca103,	// X-MAC-ICELANDIC
-  0x55315357,	// ISO-IR-138
-  0x5629acfc,	// CSKSC56011987
-  0x57518df4,	// CSEUCTW
-  0x5764a969,	// CCSID01146
-  0x5765643f,	// IBM860
-  0x57a4d81e,	// GREEK
-  0x58b62d06,	// CSIBM871
-  0x599f591e,	// CCSID00924
-  0x59ec7558,	// KSC_5601
-  0x5bdc10b1,	// CSIBM420
-  0x5cb1d4a8,	// CSIBM424
-  0x5cfee710,	// EBCDIC-LATIN9--EURO
-  0x5d2a946a,	// X-MAC-UKRAINIAN
-  0x61ad0e45,	// KOREAN
-  0x61f84a5c,	// IBM819
-  0x624e10f3,	// IBM01140
-  0x6300324f,	// ISO_8859-7:1987
-  0x6300a5b9,	// HZ-GB-2312
-  0x6370d19c,	// CSKOI8R
-  0x63bea20d,	// CP423
-  0x64caf4f1,	// CSSHIFTJIS
-  0x64d3e449,	// EBCDIC-CP-IS
-  0x6523d4ea,	// IBM01144
-  0x6598bc54,	// IBM-1047
-  0x67a63fdb,	// CSISO2INTLREFVERSION
-  0x67d55d3c,	// KOI8-R
-  0x68281804,	// CSIBM500
-  0x682e6dc8,	// ISO_8859-3:1988
-  0x69dcb9e7,	// ISO-IR-110
-  0x6c9598c1,	// IBM01148
-  0x6d77f506,	// ISO-IR-149
-  0x6d857d8b,	// EBCDIC-CP-CA
-  0x6ded8b9d,	// CSIBM855
-  0x6e630e42,	// CSISO2022KR
-  0x7001ca45,	// X-EUC-TW
-  0x7087b992,	// KS_C_5601-1989
-  0x70975d01,	// IBM905
-  0x70c788a6,	// ISO-IR-100
-  0x70ee4b6c,	// ISO-8859-1
-  0x72c532ca,	// ISO_8859-8
-  0x73b1845c,	// CSISOLATIN5
-  0x73f388d3,	// EBCDIC-CP-BE
-  0x7477bba0,	// US
-  0x74bf9300,	// CP285
-  0x74dc4045,	// CSISOLATIN1
-  0x752b5d70,	// ISO_8859-4:1988
-  0x75baf773,	// EBCDIC-CYRILLIC
-  0x771081ad,	// X-MAC-KOREAN
-  0x77838f75,	// ISO-8859-5
-  0x7980c0bc,	// CSISO58GB231280
-  0x7a5d3a83,	// ISO_646.IRV:1991
-  0x7afccce3,	// 860
-  0x7b737ee1,	// ISO_8859-4
-  0x7c4837fc,	// IBM850
-  0x7d255e5b,	// UTF-16LE
-  0x7e35c35e,	// ISO-8859-9
-  0x7f753281,	// ASMO-708
-  0x81113c73,	// X-MAC-ROMANIAN
-  0x81b4a9ef,	// MAC
-  0x82a4b914,	// EBCDIC-CP-US
-  0x82d92597,	// CSASCII
-  0x83aac36d,	// CP297
-  0x83e3eab1,	// CSIBM857
-  0x85d645b1,	// IBM00924
-  0x861d5e32,	// X-ISCII-DE
-  0x8699e404,	// BIG5
-  0x86e475c1,	// X-MAC-GREEK
-  0x88174dca,	// EBCDIC-JP-KANA
-  0x891c6059,	// EBCDIC-CP-HE
-  0x8a367bd0,	// CSISOLATINGREEK
-  0x8a8fa44a,	// IRV
-  0x8b2db5c6,	// IBM01146
-  0x8c4071df,	// IBM01142
-  0x8c4804a0,	// EUC-TW
-  0x8d486aee,	// ISO_646.IRV:1983
-  0x8d57f951,	// EBCDIC-CP-GR
-  0x8d96f372,	// CP278
-  0x9029398e,	// CSISO21GERMAN
-  0x90e0e935,	// EBCDIC-CP-GB
-  0x90f55461,	// 437
-  0x9210dbd4,	// ISO_8859-2
-  0x9244b70e,	// UTF-32
-  0x924656d0,	// IBM852
-  0x92800855,	// EBCDIC-US-37+EURO
-  0x92e6e561,	// CSGB2312
-  0x939d0202,	// EBCDIC-FR-297+EURO
-  0x939f69d6,	// 866
-  0x944cc810,	// EBCDIC-CP-FR
-  0x94f2adcf,	// 862
-  0x957d1fcd,	// ISO_8859-6
-  0x96828242,	// X-MAC-ROMAN
-  0x9731ada5,	// ISO_8859-8-I
-  0x973f9495,	// KS_C_5601-1987
-  0x98510aea,	// X-EBCDIC-KOREANEXTENDED
-  0x98ff96f0,	// CSISOLATINHEBREW
-  0x992c87c4,	// GB_2312-80
-  0x99765e2f,	// CSISO2022JP
-  0x998dee59,	// ISO-8859-7
-  0x9ad22169,	// CSISOLATIN3
-  0x9bb0a59e,	// EBCDIC-CP-AR1
-  0x9bef0eec,	// NS_4551-1
-  0x9c047228,	// EBCDIC-INTERNATIONAL-500+EURO
-  0x9e02f695,	// EBCDIC-GB-285+EURO
-  0x9e3e21c1,	// UTF-7
-  0x9ee02a40,	// ISO-8859-3
-  0xa031f29e,	// CSPC850MULTILINGUAL
-  0xa0a358cf,	// X-CHINESE-ETEN
-  0xa15ce1b4,	// CP819
-  0xa2165913,	// ISO-IR-10
-  0xa2c573e0,	// L3
-  0xa2d34090,	// CSIBM284
-  0xa31a09e5,	// IBM423
-  0xa3224e49,	// CSWINDOWS31J
-  0xa4057679,	// TIS-620
-  0xa461b38e,	// ANSI_X3.4-1986
-  0xa5be8489,	// CSIBM280
-  0xa69a7f7b,	// EBCDIC-CP-NL
-  0xa71f1195,	// UTF-16
-  0xa7e963c0,	// CSIBM1026
-  0xa829015f,	// CSIBM880
-  0xa85ce1ea,	// ISO_8859-6:1987
-  0xa8cb5646,	// LATIN1
-  0xa9cd6651,	// ARABIC
-  0xa9d5f7c8,	// GBK
-  0xab2b7120,	// ISO646-US
-  0xab319242,	// EBCDIC-NO-277+EURO
-  0xab924f11,	// ISO-IR-126
-  0xaf15e375,	// SHIFT_JIS
-  0xaf92e51f,	// MS936
-  0xafa37d6b,	// CSIBM863
-  0xafa6925f,	// LATIN5
-  0xafde4d7e,	// X-ISCII-PA
-  0xb033f6e9,	// CP905
-  0xb0871d95,	// X-ISCII-GU
-  0xb0dc846e,	// CCSID01148
-  0xb41b38e8,	// IBM285
-  0xb559d152,	// ISO_8859-1:1987
-  0xb5c5d647,	// CN-GB
-  0xb609bd8f,	// EBCDIC-IT-280+EURO
-  0xb8ee10ea,	// SEN_850200_B
-  0xb96ac845,	// CCSID01144
-  0xb96b0513,	// IBM862
-  0xba655461,	// IBM037
-  0xbb2fc9fc,	// CSIBM273
-  0xbc420de5,	// CSIBM277
-  0xbca5b5c8,	// CSIBM290
-  0xbd6cfcbd,	// IBM437
-  0xbe06c10a,	// IBM866
-  0xbe070c5c,	// CCSID01140
-  0xbe778ed5,	// ISO_8859-5:1988
-  0xbeb27e38,	// ISO_8859-9:1989
-  0xbf70e9b9,	// X-MAC-ARABIC
-  0xbfdffe0c,	// 852
-  0xc0c5e896,	// ISO-8859-15
-  0xc167f4e7,	// IBM1047
-  0xc2110252,	// EBCDIC-CP-DK
-  0xc2d5410b,	// CSIBM423
-  0xc2e3f56a,	// IBM00858
-  0xc31c087e,	// IBM284
-  0xc471cc67,	// IBM280
-  0xc4ddd90e,	// CHINESE
-  0xc52d1819,	// EBCDIC-DE-273+EURO
-  0xc5541e7d,	// IBM367
-  0xc55e7627,	// EBCDIC-ES-284+EURO
-  0xc66daedc,	// EUC-JP
-  0xc772532d,	// EBCDIC-CP-YU
-  0xc7dbb4f8,	// CCSID01149
-  0xc866ab45,	// EBCDIC-CP-ES
-  0xc8a11425,	// ISO-IR-58
-  0xc9003cca,	// CCSID01141
-  0xc9402c75,	// NO
-  0xc9cff05b,	// ELOT_928
-  0xc9e649b1,	// IBM880
-  0xcbb2887a,	// X-ISCII-TA
-  0xccdf4c63,	// X-ISCII-TE
-  0xce6c3585,	// IBM863
-  0xce6df8d3,	// CCSID01145
-  0xcfb50a83,	// 857
-  0xd0253e0c,	// UTF-32LE
-  0xd047f9b4,	// X-ISCII-BE
-  0xd0ab923f,	// CSMACINTOSH
-  0xd25b3b7d,	// PC-MULTILINGUAL-850+EURO
-  0xd37a2de1,	// DE
-  0xd5c24376,	// L2
-  0xd5cc1b45,	// CSISOLATINARABIC
-  0xd5d47006,	// CSIBM285
-  0xd6775305,	// IBM-THAI
-  0xd68abf9b,	// CSISO10SWEDISH
-  0xd6f9a977,	// SE
-  0xd722fcac,	// CP1025
-  0xd8a1a2c9,	// LATIN4
-  0xdae08112,	// IBM273
-  0xdbaa1c8f,	// CSIBM037
-  0xdc957f87,	// ISO-IR-127
-  0xdd5ab307,	// ANSI_X3.4-1968
-  0xdd6afd26,	// IBM290
-  0xdd8d450b,	// IBM277
-  0xdfc989e4,	// CSIBM866
-  0xe0268496,	// ISO-IR-6
-  0xe03a63f7,	// IBM1026
-  0xe0605762,	// CSBIG5
-  0xe07d5264,	// CSISO88598I
-  0xe22ca25f,	// IBM857
-  0xe27a2f5b,	// ISO_8859-7
-  0xe3a673d5,	// UTF-16BE
-  0xe3f59d59,	// 863
-  0xe4feebe4,	// HEBREW
-  0xe517eb42,	// ISO_8859-3
-  0xe5cdf859,	// CSISO60NORWEGIAN1
-  0xe63a023e,	// X-ISCII-OR
-  0xe6a4f4b0,	// X-CHINESE-CNS
-  0xe74b408f,	// ISO-IR-2
-  0xe869e445,	// X-JOHAB
-  0xe8fa0348,	// FI
-  0xe9e71ad6,	// ISO-8859-2
-  0xea6177e5,	// CSEUCKR
-  0xebc10b23,	// ISO-2022-KR
-  0xecb8b8c3,	// EBCDIC-CP-TR
-  0xed54a368,	// X-MAC-CYRILLIC
-  0xed57cfd4,	// ISO-IR-60
-  0xeda028f6,	// EUC-CN
-  0xedbab195,	// EBCDIC-FI-278+EURO
-  0xedd511ff,	// CSISOLATIN2
-  0xee8adecf,	// ISO-8859-6
-  0xf130fb97,	// CP-IS
-  0xf243640c,	// X-MAC-HEBREW
-  0xf329ad8f,	// GB2312
-  0xf3e6b02a,	// EUCTW
-  0xf467152b,	// LATIN-9
-  0xf8011972,	// EBCDIC-IS-871+EURO
-  0xf9b1c89f,	// KOI8-U
-  0xf9ddce00,	// CP871
-  0xfab771ea,	// EBCDIC-CP-IT
-  0xfab7f3b7,	// CP420
-  0xfb474149,	// IBM01143
-  0xfc2a8550,	// IBM01147
-  0xfdda37ae,	// CP424
-  0xfe3c3a46,	// ISO-IR-21
-  0xff088cb4,	// X-MAC-CE
-};
-
-constexpr unsigned short codepage[] = {
-       28597,	// GREEK8
-       28594,	// ISO-8859-4
-       54936,	// GB18030
-       28598,	// ISO_8859-8:1988
-         869,	// 869
-         870,	// EBCDIC-CP-ROECE
-       20284,	// CP284
-       28594,	// CSISOLATIN4
-       20280,	// CP280
-       20106,	// DIN_66003
-       28599,	// ISO_8859-9
-       20127,	// CP367
-       10021,	// X-MAC-THAI
-       57008,	// X-ISCII-KA
-       28595,	// CSISOLATINCYRILLIC
-       28595,	// CYRILLIC
-       28592,	// ISO-IR-101
-       28593,	// ISO-IR-109
-       28598,	// ISO-8859-8
-       20880,	// CP880
-       20107,	// ISO646-SE
-         500,	// IBM500
-         865,	// 865
-       28591,	// ISO_8859-1
-         855,	// IBM855
-       20106,	// ISO646-DE
-       28595,	// ISO_8859-5
-         861,	// 861
-       65001,	// UTF-8
-         862,	// CSPC862LATINHEBREW
-       57006,	// X-ISCII-AS
-       51932,	// EXTENDED_UNIX_CODE_PACKED_FORMAT_FOR_JAPANESE
-       20905,	// CSIBM905
-        1145,	// IBM01145
-       28595,	// ISO-IR-144
-         500,	// EBCDIC-CP-CH
-        1141,	// IBM01141
-       20108,	// ISO646-NO
-       51932,	// CSEUCPKDFMTJAPANESE
-        1361,	// JOHAB
-         869,	// CP-GR
-       20273,	// CP273
-       28599,	// ISO-IR-148
-         932,	// WINDOWS-31J
-        1149,	// IBM01149
-       50221,	// ISO-2022-JP
-       20290,	// CP290
-       20278,	// EBCDIC-CP-FI
-         858,	// CCSID00858
-       10008,	// X-MAC-CHINESESIMP
-       20278,	// EBCDIC-CP-SE
-         861,	// IBM861
-        1147,	// CCSID01147
-       10081,	// X-MAC-TURKISH
-         855,	// 855
-       20297,	// CSIBM297
-       10002,	// X-MAC-CHINESETRAD
-         775,	// CSPC775BALTIC
-       20127,	// ASCII
-       10001,	// X-MAC-JAPANESE
-        1143,	// CCSID01143
-         865,	// IBM865
-       20000,	// X-CHINESE_CNS
-        1143,	// EBCDIC-SE-278+EURO
-       28603,	// ISO-8859-13
-       20278,	// CSIBM278
-       28605,	// ISO_8859-15
-         869,	// IBM869
-          37,	// EBCDIC-CP-WT
-         870,	// CSIBM870
-       51949,	// EUC-KR
-       20127,	// US-ASCII
-       28592,	// LATIN2
-         864,	// CSIBM864
-       28592,	// ISO_8859-2:1987
-         775,	// IBM775
-       20838,	// CSIBMTHAI
-         860,	// CSIBM860
-       50227,	// ISO-2022-CN
-       20107,	// ISO646-FI
-       28596,	// ECMA-114
-       20871,	// IBM871
-       20420,	// IBM420
-       28594,	// L4
-       20424,	// IBM424
-       28597,	// ECMA-118
-       20277,	// EBCDIC-CP-NO
-        1142,	// EBCDIC-DK-277+EURO
-       10000,	// MACINTOSH
-         861,	// CSIBM861
-       20297,	// IBM297
-       29001,	// X-EUROPA
-       20108,	// CSISO60DANISHNORWEGIAN
-       10082,	// X-MAC-CROATIAN
-         865,	// CSIBM865
-       28593,	// LATIN3
-         852,	// CSPCP852
-       38598,	// ISO-8859-8-I
-         932,	// MS_KANJI
-       28599,	// L5
-       28591,	// L1
-       20278,	// IBM278
-         437,	// CSPC8CODEPAGE437
-         870,	// IBM870
-       12001,	// UTF-32BE
-         869,	// CSIBM869
-         864,	// IBM864
-        1142,	// CCSID01142
-       57009,	// X-ISCII-MA
-         850,	// 850
-       20924,	// CP00924
-       10079,	// X-MAC-ICELANDIC
-       28598,	// ISO-IR-138
-         949,	// CSKSC56011987
-       51950,	// CSEUCTW
-        1146,	// CCSID01146
-         860,	// IBM860
-       28597,	// GREEK
-       20871,	// CSIBM871
-       20924,	// CCSID00924
-         949,	// KSC_5601
-       20420,	// CSIBM420
-       20424,	// CSIBM424
-       20924,	// EBCDIC-LATIN9--EURO
-       10017,	// X-MAC-UKRAINIAN
-         949,	// KOREAN
-       28591,	// IBM819
-        1140,	// IBM01140
-       28597,	// ISO_8859-7:1987
-       52936,	// HZ-GB-2312
-       20866,	// CSKOI8R
-       20423,	// CP423
-         932,	// CSSHIFTJIS
-       20871,	// EBCDIC-CP-IS
-        1144,	// IBM01144
-        1047,	// IBM-1047
-       20105,	// CSISO2INTLREFVERSION
-       20866,	// KOI8-R
-         500,	// CSIBM500
-       28593,	// ISO_8859-3:1988
-       28594,	// ISO-IR-110
-        1148,	// IBM01148
-         949,	// ISO-IR-149
-          37,	// EBCDIC-CP-CA
-         855,	// CSIBM855
-       50225,	// CSISO2022KR
-       51950,	// X-EUC-TW
-         949,	// KS_C_5601-1989
-       20905,	// IBM905
-       28591,	// ISO-IR-100
-       28591,	// ISO-8859-1
-       28598,	// ISO_8859-8
-       28599,	// CSISOLATIN5
-         500,	// EBCDIC-CP-BE
-       20127,	// US
-       20285,	// CP285
-       28591,	// CSISOLATIN1
-       28594,	// ISO_8859-4:1988
-       20880,	// EBCDIC-CYRILLIC
-       10003,	// X-MAC-KOREAN
-       28595,	// ISO-8859-5
-       20936,	// CSISO58GB231280
-       20127,	// ISO_646.IRV:1991
-         860,	// 860
-       28594,	// ISO_8859-4
-         850,	// IBM850
-        1200,	// UTF-16LE
-       28599,	// ISO-8859-9
-       28596,	// ASMO-708
-       10010,	// X-MAC-ROMANIAN
-       10000,	// MAC
-          37,	// EBCDIC-CP-US
-       20127,	// CSASCII
-       20297,	// CP297
-         857,	// CSIBM857
-       20924,	// IBM00924
-       57002,	// X-ISCII-DE
-         950,	// BIG5
-       10006,	// X-MAC-GREEK
-       20290,	// EBCDIC-JP-KANA
-       20424,	// EBCDIC-CP-HE
-       28597,	// CSISOLATINGREEK
-       20105,	// IRV
-        1146,	// IBM01146
-        1142,	// IBM01142
-       51950,	// EUC-TW
-       20105,	// ISO_646.IRV:1983
-       20423,	// EBCDIC-CP-GR
-       20278,	// CP278
-       20106,	// CSISO21GERMAN
-       20285,	// EBCDIC-CP-GB
-         437,	// 437
-       28592,	// ISO_8859-2
-       12000,	// UTF-32
-         852,	// IBM852
-        1140,	// EBCDIC-US-37+EURO
-         936,	// CSGB2312
-        1147,	// EBCDIC-FR-297+EURO
-         866,	// 866
-       20297,	// EBCDIC-CP-FR
-         862,	// 862
-       28596,	// ISO_8859-6
-       10000,	// X-MAC-ROMAN
-       38598,	// ISO_8859-8-I
-         949,	// KS_C_5601-1987
-       20833,	// X-EBCDIC-KOREANEXTENDED
-       28598,	// CSISOLATINHEBREW
-       20936,	// GB_2312-80
-       50221,	// CSISO2022JP
-       28597,	// ISO-8859-7
-       28593,	// CSISOLATIN3
-       20420,	// EBCDIC-CP-AR1
-       20108,	// NS_4551-1
-        1148,	// EBCDIC-INTERNATIONAL-500+EURO
-        1146,	// EBCDIC-GB-285+EURO
-       65000,	// UTF-7
-       28593,	// ISO-8859-3
-         850,	// CSPC850MULTILINGUAL
-       20002,	// X-CHINESE-ETEN
-       28591,	// CP819
-       20107,	// ISO-IR-10
-       28593,	// L3
-       20284,	// CSIBM284
-       20423,	// IBM423
-         932,	// CSWINDOWS31J
-         874,	// TIS-620
-       20127,	// ANSI_X3.4-1986
-       20280,	// CSIBM280
-          37,	// EBCDIC-CP-NL
-        1200,	// UTF-16
-        1026,	// CSIBM1026
-       20880,	// CSIBM880
-       28596,	// ISO_8859-6:1987
-       28591,	// LATIN1
-       28596,	// ARABIC
-         936,	// GBK
-       20127,	// ISO646-US
-        1142,	// EBCDIC-NO-277+EURO
-       28597,	// ISO-IR-126
-         932,	// SHIFT_JIS
-         936,	// MS936
-         863,	// CSIBM863
-       28599,	// LATIN5
-       57011,	// X-ISCII-PA
-       20905,	// CP905
-       57010,	// X-ISCII-GU
-        1148,	// CCSID01148
-       20285,	// IBM285
-       28591,	// ISO_8859-1:1987
-       51936,	// CN-GB
-        1144,	// EBCDIC-IT-280+EURO
-       20107,	// SEN_850200_B
-        1144,	// CCSID01144
-         862,	// IBM862
-          37,	// IBM037
-       20273,	// CSIBM273
-       20277,	// CSIBM277
-       20290,	// CSIBM290
-         437,	// IBM437
-         866,	// IBM866
-        1140,	// CCSID01140
-       28595,	// ISO_8859-5:1988
-       28599,	// ISO_8859-9:1989
-       10004,	// X-MAC-ARABIC
-         852,	// 852
-       28605,	// ISO-8859-15
-        1047,	// IBM1047
-       20277,	// EBCDIC-CP-DK
-       20423,	// CSIBM423
-         858,	// IBM00858
-       20284,	// IBM284
-       20280,	// IBM280
-       20936,	// CHINESE
-        1141,	// EBCDIC-DE-273+EURO
-       20127,	// IBM367
-        1145,	// EBCDIC-ES-284+EURO
-       51932,	// EUC-JP
-         870,	// EBCDIC-CP-YU
-        1149,	// CCSID01149
-       20284,	// EBCDIC-CP-ES
-       20936,	// ISO-IR-58
-        1141,	// CCSID01141
-       20108,	// NO
-       28597,	// ELOT_928
-       20880,	// IBM880
-       57004,	// X-ISCII-TA
-       57005,	// X-ISCII-TE
-         863,	// IBM863
-        1145,	// CCSID01145
-         857,	// 857
-       12000,	// UTF-32LE
-       57003,	// X-ISCII-BE
-       10000,	// CSMACINTOSH
-         858,	// PC-MULTILINGUAL-850+EURO
-       20106,	// DE
-       28592,	// L2
-       28596,	// CSISOLATINARABIC
-       20285,	// CSIBM285
-       20838,	// IBM-THAI
-       20107,	// CSISO10SWEDISH
-       20107,	// SE
-       21025,	// CP1025
-       28594,	// LATIN4
-       20273,	// IBM273
-          37,	// CSIBM037
-       28596,	// ISO-IR-127
-       20127,	// ANSI_X3.4-1968
-       20290,	// IBM290
-       20277,	// IBM277
-         866,	// CSIBM866
-       20127,	// ISO-IR-6
-        1026,	// IBM1026
-         950,	// CSBIG5
-       38598,	// CSISO88598I
-         857,	// IBM857
-       28597,	// ISO_8859-7
-        1201,	// UTF-16BE
-         863,	// 863
-       28598,	// HEBREW
-       28593,	// ISO_8859-3
-       20108,	// CSISO60NORWEGIAN1
-       57007,	// X-ISCII-OR
-       20000,	// X-CHINESE-CNS
-       20105,	// ISO-IR-2
-        1361,	// X-JOHAB
-       20107,	// FI
-       28592,	// ISO-8859-2
-       51949,	// CSEUCKR
-       50225,	// ISO-2022-KR
-       20905,	// EBCDIC-CP-TR
-       10007,	// X-MAC-CYRILLIC
-       20108,	// ISO-IR-60
-       51936,	// EUC-CN
-        1143,	// EBCDIC-FI-278+EURO
-       28592,	// CSISOLATIN2
-       28596,	// ISO-8859-6
-         861,	// CP-IS
-       10005,	// X-MAC-HEBREW
-         936,	// GB2312
-       51950,	// EUCTW
-       28605,	// LATIN-9
-        1149,	// EBCDIC-IS-871+EURO
-       21866,	// KOI8-U
-       20871,	// CP871
-       20280,	// EBCDIC-CP-IT
-       20420,	// CP420
-        1143,	// IBM01143
-        1147,	// IBM01147
-       20424,	// CP424
-       20106,	// ISO-IR-21
-       10029,	// X-MAC-CE
+constexpr struct {
+  char const* name;
+  unsigned short codepage;
+} aliases[] = {
+  { "IBM037", 37 },
+  { "EBCDIC-CP-US", 37 },
+  { "EBCDIC-CP-CA", 37 },
+  { "EBCDIC-CP-WT", 37 },
+  { "EBCDIC-CP-NL", 37 },
+  { "CSIBM037", 37 },
+  { "IBM437", 437 },
+  { "437", 437 },
+  { "CSPC8CODEPAGE437", 437 },
+  { "IBM500", 500 },
+  { "EBCDIC-CP-BE", 500 },
+  { "EBCDIC-CP-CH", 500 },
+  { "CSIBM500", 500 },
+  { "IBM775", 775 },
+  { "CSPC775BALTIC", 775 },
+  { "IBM850", 850 },
+  { "850", 850 },
+  { "CSPC850MULTILINGUAL", 850 },
+  { "IBM852", 852 },
+  { "852", 852 },
+  { "CSPCP852", 852 },
+  { "IBM855", 855 },
+  { "855", 855 },
+  { "CSIBM855", 855 },
+  { "IBM857", 857 },
+  { "857", 857 },
+  { "CSIBM857", 857 },
+  { "IBM00858", 858 },
+  { "CCSID00858", 858 },
+  { "PC-MULTILINGUAL-850+EURO", 858 },
+  { "IBM860", 860 },
+  { "860", 860 },
+  { "CSIBM860", 860 },
+  { "IBM861", 861 },
+  { "861", 861 },
+  { "CP-IS", 861 },
+  { "CSIBM861", 861 },
+  { "IBM862", 862 },
+  { "862", 862 },
+  { "CSPC862LATINHEBREW", 862 },
+  { "IBM863", 863 },
+  { "863", 863 },
+  { "CSIBM863", 863 },
+  { "IBM864", 864 },
+  { "CSIBM864", 864 },
+  { "IBM865", 865 },
+  { "865", 865 },
+  { "CSIBM865", 865 },
+  { "IBM866", 866 },
+  { "866", 866 },
+  { "CSIBM866", 866 },
+  { "IBM869", 869 },
+  { "869", 869 },
+  { "CP-GR", 869 },
+  { "CSIBM869", 869 },
+  { "IBM870", 870 },
+  { "EBCDIC-CP-ROECE", 870 },
+  { "EBCDIC-CP-YU", 870 },
+  { "CSIBM870", 870 },
+  { "TIS-620", 874 },
+  { "SHIFT_JIS", 932 },
+  { "MS_KANJI", 932 },
+  { "CSSHIFTJIS", 932 },
+  { "WINDOWS-31J", 932 },
+  { "CSWINDOWS31J", 932 },
+  { "GB2312", 936 },
+  { "CSGB2312", 936 },
+  { "GBK", 936 },
+  { "MS936", 936 },
+  { "KS_C_5601-1987", 949 },
+  { "ISO-IR-149", 949 },
+  { "KS_C_5601-1989", 949 },
+  { "KSC_5601", 949 },
+  { "KOREAN", 949 },
+  { "CSKSC56011987", 949 },
+  { "BIG5", 950 },
+  { "CSBIG5", 950 },
+  { "IBM1026", 1026 },
+  { "CSIBM1026", 1026 },
+  { "IBM1047", 1047 },
+  { "IBM-1047", 1047 },
+  { "IBM01140", 1140 },
+  { "CCSID01140", 1140 },
+  { "EBCDIC-US-37+EURO", 1140 },
+  { "IBM01141", 1141 },
+  { "CCSID01141", 1141 },
+  { "EBCDIC-DE-273+EURO", 1141 },
+  { "IBM01142", 1142 },
+  { "CCSID01142", 1142 },
+  { "EBCDIC-DK-277+EURO", 1142 },
+  { "EBCDIC-NO-277+EURO", 1142 },
+  { "IBM01143", 1143 },
+  { "CCSID01143", 1143 },
+  { "EBCDIC-FI-278+EURO", 1143 },
+  { "EBCDIC-SE-278+EURO", 1143 },
+  { "IBM01144", 1144 },
+  { "CCSID01144", 1144 },
+  { "EBCDIC-IT-280+EURO", 1144 },
+  { "IBM01145", 1145 },
+  { "CCSID01145", 1145 },
+  { "EBCDIC-ES-284+EURO", 1145 },
+  { "IBM01146", 1146 },
+  { "CCSID01146", 1146 },
+  { "EBCDIC-GB-285+EURO", 1146 },
+  { "IBM01147", 1147 },
+  { "CCSID01147", 1147 },
+  { "EBCDIC-FR-297+EURO", 1147 },
+  { "IBM01148", 1148 },
+  { "CCSID01148", 1148 },
+  { "EBCDIC-INTERNATIONAL-500+EURO", 1148 },
+  { "IBM01149", 1149 },
+  { "CCSID01149", 1149 },
+  { "EBCDIC-IS-871+EURO", 1149 },
+  { "UTF-16", 1200 },
+  { "UTF-16LE", 1200 },
+  { "UTF-16BE", 1201 },
+  { "JOHAB", 1361 },
+  { "X-JOHAB", 1361 },
+  { "MACINTOSH", 10000 },
+  { "MAC", 10000 },
+  { "CSMACINTOSH", 10000 },
+  { "X-MAC-ROMAN", 10000 },
+  { "X-MAC-JAPANESE", 10001 },
+  { "X-MAC-CHINESETRAD", 10002 },
+  { "X-MAC-KOREAN", 10003 },
+  { "X-MAC-ARABIC", 10004 },
+  { "X-MAC-HEBREW", 10005 },
+  { "X-MAC-GREEK", 10006 },
+  { "X-MAC-CYRILLIC", 10007 },
+  { "X-MAC-CHINESESIMP", 10008 },
+  { "X-MAC-ROMANIAN", 10010 },
+  { "X-MAC-UKRAINIAN", 10017 },
+  { "X-MAC-THAI", 10021 },
+  { "X-MAC-CE", 10029 },
+  { "X-MAC-ICELANDIC", 10079 },
+  { "X-MAC-TURKISH", 10081 },
+  { "X-MAC-CROATIAN", 10082 },
+  { "UTF-32", 12000 },
+  { "UTF-32LE", 12000 },
+  { "UTF-32BE", 12001 },
+  { "X-CHINESE_CNS", 20000 },
+  { "X-CHINESE-CNS", 20000 },
+  { "X-CHINESE-ETEN", 20002 },
+  { "ISO_646.IRV:1983", 20105 },
+  { "ISO-IR-2", 20105 },
+  { "IRV", 20105 },
+  { "CSISO2INTLREFVERSION", 20105 },
+  { "DIN_66003", 20106 },
+  { "ISO-IR-21", 20106 },
+  { "DE", 20106 },
+  { "ISO646-DE", 20106 },
+  { "CSISO21GERMAN", 20106 },
+  { "SEN_850200_B", 20107 },
+  { "ISO-IR-10", 20107 },
+  { "FI", 20107 },
+  { "ISO646-FI", 20107 },
+  { "ISO646-SE", 20107 },
+  { "SE", 20107 },
+  { "CSISO10SWEDISH", 20107 },
+  { "NS_4551-1", 20108 },
+  { "ISO-IR-60", 20108 },
+  { "ISO646-NO", 20108 },
+  { "NO", 20108 },
+  { "CSISO60DANISHNORWEGIAN", 20108 },
+  { "CSISO60NORWEGIAN1", 20108 },
+  { "ANSI_X3.4-1968", 20127 },
+  { "ISO-IR-6", 20127 },
+  { "ANSI_X3.4-1986", 20127 },
+  { "ISO_646.IRV:1991", 20127 },
+  { "ASCII", 20127 },
+  { "ISO646-US", 20127 },
+  { "US-ASCII", 20127 },
+  { "US", 20127 },
+  { "IBM367", 20127 },
+  { "CP367", 20127 },
+  { "CSASCII", 20127 },
+  { "IBM273", 20273 },
+  { "CP273", 20273 },
+  { "CSIBM273", 20273 },
+  { "IBM277", 20277 },
+  { "EBCDIC-CP-DK", 20277 },
+  { "EBCDIC-CP-NO", 20277 },
+  { "CSIBM277", 20277 },
+  { "IBM278", 20278 },
+  { "CP278", 20278 },
+  { "EBCDIC-CP-FI", 20278 },
+  { "EBCDIC-CP-SE", 20278 },
+  { "CSIBM278", 20278 },
+  { "IBM280", 20280 },
+  { "CP280", 20280 },
+  { "EBCDIC-CP-IT", 20280 },
+  { "CSIBM280", 20280 },
+  { "IBM284", 20284 },
+  { "CP284", 20284 },
+  { "EBCDIC-CP-ES", 20284 },
+  { "CSIBM284", 20284 },
+  { "IBM285", 20285 },
+  { "CP285", 20285 },
+  { "EBCDIC-CP-GB", 20285 },
+  { "CSIBM285", 20285 },
+  { "IBM290", 20290 },
+  { "CP290", 20290 },
+  { "EBCDIC-JP-KANA", 20290 },
+  { "CSIBM290", 20290 },
+  { "IBM297", 20297 },
+  { "CP297", 20297 },
+  { "EBCDIC-CP-FR", 20297 },
+  { "CSIBM297", 20297 },
+  { "IBM420", 20420 },
+  { "CP420", 20420 },
+  { "EBCDIC-CP-AR1", 20420 },
+  { "CSIBM420", 20420 },
+  { "IBM423", 20423 },
+  { "CP423", 20423 },
+  { "EBCDIC-CP-GR", 20423 },
+  { "CSIBM423", 20423 },
+  { "IBM424", 20424 },
+  { "CP424", 20424 },
+  { "EBCDIC-CP-HE", 20424 },
+  { "CSIBM424", 20424 },
+  { "X-EBCDIC-KOREANEXTENDED", 20833 },
+  { "IBM-THAI", 20838 },
+  { "CSIBMTHAI", 20838 },
+  { "KOI8-R", 20866 },
+  { "CSKOI8R", 20866 },
+  { "IBM871", 20871 },
+  { "CP871", 20871 },
+  { "EBCDIC-CP-IS", 20871 },
+  { "CSIBM871", 20871 },
+  { "IBM880", 20880 },
+  { "CP880", 20880 },
+  { "EBCDIC-CYRILLIC", 20880 },
+  { "CSIBM880", 20880 },
+  { "IBM905", 20905 },
+  { "CP905", 20905 },
+  { "EBCDIC-CP-TR", 20905 },
+  { "CSIBM905", 20905 },
+  { "IBM00924", 20924 },
+  { "CCSID00924", 20924 },
+  { "CP00924", 20924 },
+  { "EBCDIC-LATIN9--EURO", 20924 },
+  { "GB_2312-80", 20936 },
+  { "ISO-IR-58", 20936 },
+  { "CHINESE", 20936 },
+  { "CSISO58GB231280", 20936 },
+  { "CP1025", 21025 },
+  { "KOI8-U", 21866 },
+  { "ISO_8859-1:1987", 28591 },
+  { "ISO-IR-100", 28591 },
+  { "ISO_8859-1", 28591 },
+  { "ISO-8859-1", 28591 },
+  { "LATIN1", 28591 },
+  { "L1", 28591 },
+  { "IBM819", 28591 },
+  { "CP819", 28591 },
+  { "CSISOLATIN1", 28591 },
+  { "ISO_8859-2:1987", 28592 },
+  { "ISO-IR-101", 28592 },
+  { "ISO_8859-2", 28592 },
+  { "ISO-8859-2", 28592 },
+  { "LATIN2", 28592 },
+  { "L2", 28592 },
+  { "CSISOLATIN2", 28592 },
+  { "ISO_8859-3:1988", 28593 },
+  { "ISO-IR-109", 28593 },
+  { "ISO_8859-3", 28593 },
+  { "ISO-8859-3", 28593 },
+  { "LATIN3", 28593 },
+  { "L3", 28593 },
+  { "CSISOLATIN3", 28593 },
+  { "ISO_8859-4:1988", 28594 },
+  { "ISO-IR-110", 28594 },
+  { "ISO_8859-4", 28594 },
+  { "ISO-8859-4", 28594 },
+  { "LATIN4", 28594 },
+  { "L4", 28594 },
+  { "CSISOLATIN4", 28594 },
+  { "ISO_8859-5:1988", 28595 },
+  { "ISO-IR-144", 28595 },
+  { "ISO_8859-5", 28595 },
+  { "ISO-8859-5", 28595 },
+  { "CYRILLIC", 28595 },
+  { "CSISOLATINCYRILLIC", 28595 },
+  { "ISO_8859-6:1987", 28596 },
+  { "ISO-IR-127", 28596 },
+  { "ISO_8859-6", 28596 },
+  { "ISO-8859-6", 28596 },
+  { "ECMA-114", 28596 },
+  { "ASMO-708", 28596 },
+  { "ARABIC", 28596 },
+  { "CSISOLATINARABIC", 28596 },
+  { "ISO_8859-7:1987", 28597 },
+  { "ISO-IR-126", 28597 },
+  { "ISO_8859-7", 28597 },
+  { "ISO-8859-7", 28597 },
+  { "ELOT_928", 28597 },
+  { "ECMA-118", 28597 },
+  { "GREEK", 28597 },
+  { "GREEK8", 28597 },
+  { "CSISOLATINGREEK", 28597 },
+  { "ISO_8859-8:1988", 28598 },
+  { "ISO-IR-138", 28598 },
+  { "ISO_8859-8", 28598 },
+  { "ISO-8859-8", 28598 },
+  { "HEBREW", 28598 },
+  { "CSISOLATINHEBREW", 28598 },
+  { "ISO_8859-9:1989", 28599 },
+  { "ISO-IR-148", 28599 },
+  { "ISO_8859-9", 28599 },
+  { "ISO-8859-9", 28599 },
+  { "LATIN5", 28599 },
+  { "L5", 28599 },
+  { "CSISOLATIN5", 28599 },
+  { "ISO-8859-13", 28603 },
+  { "ISO-8859-15", 28605 },
+  { "ISO_8859-15", 28605 },
+  { "LATIN-9", 28605 },
+  { "X-EUROPA", 29001 },
+  { "ISO_8859-8-I", 38598 },
+  { "CSISO88598I", 38598 },
+  { "ISO-8859-8-I", 38598 },
+  { "ISO-2022-JP", 50221 },
+  { "CSISO2022JP", 50221 },
+  { "ISO-2022-KR", 50225 },
+  { "CSISO2022KR", 50225 },
+  { "ISO-2022-CN", 50227 },
+  { "EXTENDED_UNIX_CODE_PACKED_FORMAT_FOR_JAPANESE", 51932 },
+  { "CSEUCPKDFMTJAPANESE", 51932 },
+  { "EUC-JP", 51932 },
+  { "EUC-CN", 51936 },
+  { "CN-GB", 51936 },
+  { "EUC-KR", 51949 },
+  { "CSEUCKR", 51949 },
+  { "X-EUC-TW", 51950 },
+  { "EUC-TW", 51950 },
+  { "EUCTW", 51950 },
+  { "CSEUCTW", 51950 },
+  { "HZ-GB-2312", 52936 },
+  { "GB18030", 54936 },
+  { "X-ISCII-DE", 57002 },
+  { "X-ISCII-BE", 57003 },
+  { "X-ISCII-TA", 57004 },
+  { "X-ISCII-TE", 57005 },
+  { "X-ISCII-AS", 57006 },
+  { "X-ISCII-OR", 57007 },
+  { "X-ISCII-KA", 57008 },
+  { "X-ISCII-MA", 57009 },
+  { "X-ISCII-GU", 57010 },
+  { "X-ISCII-PA", 57011 },
+  { "UTF-7", 65000 },
+  { "UTF-8", 65001 },
 };
@@ -0,0 +1,117 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+/** executor - run the tasks on the bounded number of threads.
+ * T::run() is called on a worker thread for each dispatched task.
+ * The threads are made on demand, and the surplus threads end when
+ * the limit is lowered. The destructor waits for all the threads.
+ */
+template<class T>
+class executor {
+  std::mutex _mutex;
+  std::condition_variable _cond;  // the queue is changed.
+  std::condition_variable _ended; // a thread ended.
+  std::deque<T*> _queue;
+  unsigned _limit = 8;
+  unsigned _threads = 0;  // running threads.
+  unsigned _waiting = 0;  // threads waiting for a task.
+  bool _exit = false;
+  bool _surplus() const noexcept { return _exit || _threads > _limit; }
+  void _spawn();
+  void _worker() noexcept;
+public:
+  executor() {}
+  executor(executor const&) = delete;
+  executor& operator=(executor const&) = delete;
+  ~executor();
+  void limit(unsigned limit);
+  unsigned threads();
+  void dispatch(T* task);
+  bool cancel(T* task);
+};
+
+/*
+ * Functions of the class executor
+ */
+template<class T>
+executor<T>::~executor()
+{
+  std::unique_lock lock(_mutex);
+  _exit = true;
+  _cond.notify_all();
+  _ended.wait(lock, [this] { return _threads == 0; });
+}
+
+template<class T> void
+executor<T>::limit(unsigned limit)
+{
+  std::lock_guard lock(_mutex);
+  _limit = limit ? limit : 1;
+  _cond.notify_all(); // the surplus threads waiting for a task end.
+}
+
+template<class T> unsigned
+executor<T>::threads()
+{
+  std::lock_guard lock(_mutex);
+  return _threads;
+}
+
+template<class T> void
+executor<T>::_spawn()
+{
+  if (_queue.size() > _waiting && _threads < _limit) {
+    std::thread([this] { _worker(); }).detach();
+    ++_threads;
+  }
+}
+
+template<class T> void
+executor<T>::_worker() noexcept
+{
+  std::unique_lock lock(_mutex);
+  for (;;) {
+    ++_waiting;
+    _cond.wait(lock, [this] { return _surplus() || !_queue.empty(); });
+    --_waiting;
+    if (_surplus()) break;
+    auto task = _queue.front();
+    _queue.pop_front();
+    lock.unlock();
+    task->run();
+    lock.lock();
+  }
+  --_threads;
+  if (!_exit && !_queue.empty()) _cond.notify_one(); // pass the task on.
+  _ended.notify_all();
+}
+
+template<class T> void
+executor<T>::dispatch(T* task)
+{
+  std::lock_guard lock(_mutex);
+  _queue.push_back(task);
+  _spawn();
+  _cond.notify_one();
+}
+
+template<class T> bool
+executor<T>::cancel(T* task)
+{
+  std::lock_guard lock(_mutex);
+  auto p = std::find(_queue.begin(), _queue.end(), task);
+  if (p == _queue.end()) return false;
+  _queue.erase(p);
+  return true;
+}
@@ -5,105 +5,163 @@
  * the license terms, see the LICENSE.txt file included with the program.
  */
 #include "stdafx.h"
+#include <unordered_map>
+#include <algorithm>
+#include <charconv>
+
+#define IDLE_LIMIT 1680 // seconds to keep IDLE, less than 29 minutes.
 
 /** imap4 - imap4 protocol backend
  * This class is a mailbox::backend for IMAP4 protocol.
  */
 class imap4 : public mailbox::backend {
   unsigned _seq = _seqinit(); // sequencial number for the tag.
+  bool _qresync = false;      // QRESYNC was enabled.
+  unsigned long _validity = 0;     // UIDVALIDITY of the examined mailbox.
+  unsigned long long _highest = 0; // HIGHESTMODSEQ of the examined mailbox.
+  std::string _idletag;            // tag of the last IDLE command.
+  bool _idling = false;            // IDLE is in progress.
+  time_t _idlesince = 0;
+  bool _notified = false;          // an event was notified while idling.
+  // the changes tracked by the sequence numbers while idling (without QRESYNC).
+  unsigned long _exists = 0;        // number of messages.
+  std::vector<unsigned long> _uids; // UIDs of the sequence numbers.
+  bool _mapped = false;             // _uids matches the mailbox.
+  std::unordered_map<std::string, bool> _changed; // UID and \Seen flag.
+  std::unordered_set<std::string> _expunged;
 
   // parser - imap4 response parser.
-  struct parser : public tokenizer {
-    parser() {}
-    parser(std::string const& s) : tokenizer(s) {}
-    std::string token(bool open = false);
+  // The tokens are the views of the response. A list is taken as a token
+  // at once, and its elements are taken by another parser over the list.
+  class parser {
+    std::string_view _s;
+    size_t _skip(size_t i) const;
+  public:
+    parser(std::string_view s = {}) noexcept : _s(s) {}
+    explicit operator bool() const noexcept { return !_s.empty(); }
+    auto remain() const noexcept { return _s; }
+    int peek() const noexcept { return !_s.empty() ? _s[0] & 255 : -1; }
+    std::string_view token(bool open = false);
+  };
+
+  // response - imap4 response type, valid until the next response.
+  struct response {
+    std::string_view tag, type, data;
+    unsigned long number = 0; // the number preceding the type.
+    std::string text() const { return std::string(type) + ' ' + std::string(data); }
   };
+  std::string _line; // the response joined with the literals.
 
-  // response - imap4 response type.
-  struct response { std::string tag, type, data; };
+  static bool _is(std::string_view s, std::string_view upper) noexcept
+  { return tokenizer::equal(s, upper); }
+  static unsigned long long _number(std::string_view s) noexcept;
 
   static std::string _utf7m(std::string_view s);
   std::string _tag();
   static std::string _arg(std::string_view arg);
+  template<class It> static std::string _uidset(It& it, It end);
+  void _enable(std::string const& cap);
+  size_t _recents(std::vector<std::string> uids, maillist& mails);
   size_t _fetch(mailbox& mbox);
-  void _idle();
+  size_t _sync(mailbox& mbox, unsigned long long modseq);
+  void _map();
+  void _track(response const& resp);
+  size_t _update(mailbox& mbox);
+  static bool _event(response const& resp);
+  void _done(response resp);
+  using untagged = std::function<void(response const&)>;
+  response _command(std::string_view cmd, untagged const& untagged);
   std::string _command(std::string_view cmd, std::string_view res = {});
   response _response(bool logout = false);
-  std::string _read();
+  std::string_view _read();
+  static bool _literal(std::string_view line, size_t& size) noexcept;
   unsigned _seqinit() const { return unsigned(ptrdiff_t(this)) + unsigned(time({})); }
-#ifdef _DEBUG
-  using backend::read;
-  std::string read() {
-    auto line = backend::read();
-    LOG("R: " << line << std::endl);
-    return line;
-  }
-#endif
 public:
   bool login(uri const& uri, std::string const& passwd) override;
   void logout() override;
   size_t fetch(mailbox& mbox, uri const& uri) override;
   size_t fetch(mailbox& mbox) override;
+  bool persistent() const noexcept override { return true; }
+  bool alive() override;
+  unsigned idle() override;
+  unsigned wake() override;
+  bool pending() const noexcept override { return _notified || backend::pending(); }
 };
 
 bool
 imap4::login(uri const& uri, std::string const& passwd)
 {
   constexpr char notimap[] = "server not IMAP4 compliant";
-  auto [tag, type, data] = _response();
-  auto preauth = type == "PREAUTH";
-  if (tag != "*" || (!preauth && type != "OK")) throw mailbox::error(notimap);
+  auto resp = _response();
+  auto preauth = _is(resp.type, "PREAUTH");
+  if (resp.tag != "*" || (!preauth && !_is(resp.type, "OK"))) throw mailbox::error(notimap);
   auto imap = false, stls = false, idle = false;
   constexpr char CAPABILITY[] = "CAPABILITY", STARTTLS[] = "STARTTLS", IDLE[] = "IDLE";
   auto cap = _command(CAPABILITY, CAPABILITY);
   for (parser caps(cap); caps;) {
     auto s = caps.token();
-    imap = imap || s == "IMAP4" || s == "IMAP4REV1";
-    stls = stls || s == STARTTLS;
-    idle = idle || s == IDLE;
+    imap = imap || _is(s, "IMAP4") || _is(s, "IMAP4REV1");
+    stls = stls || _is(s, STARTTLS);
+    idle = idle || _is(s, IDLE);
   }
   if (!imap) throw mailbox::error(notimap);
-  if (preauth) return idle;
+  if (preauth) return _enable(cap), idle;
   if (stls && !tls()) {
     _command(STARTTLS);
     starttls(uri[uri::host]);
     cap = _command(CAPABILITY, CAPABILITY);
-    idle = false;
   }
   for (parser caps(cap); caps;) {
-    auto s = caps.token();
-    if (s == "LOGINDISABLED") throw mailbox::error("login disabled");
-    idle = idle || s == IDLE;
-  }
-  if (cap = _command("LOGIN" + _arg(uri[uri::user]) + _arg(passwd), CAPABILITY); !cap.empty()) {
-    idle = false;
-    for (parser caps(cap); caps;) {
-      auto s = caps.token();
-      idle = idle || s == IDLE;
-    }
+    if (_is(caps.token(), "LOGINDISABLED")) throw mailbox::error("login disabled");
   }
+  // the capabilities such as QRESYNC and COMPRESS may be advertised only
+  // after the authentication.
+  cap = _command("LOGIN" + _arg(uri[uri::user]) + _arg(passwd), CAPABILITY);
+  if (cap.empty()) cap = _command(CAPABILITY, CAPABILITY);
+  idle = false;
+  for (parser caps(cap); caps;) idle = _is(caps.token(), IDLE) || idle;
+  _enable(cap);
   return idle;
 }
 
 void
 imap4::logout()
 {
+  if (_idling) _done({});
   _command("LOGOUT");
 }
 
+bool
+imap4::alive()
+{
+  // the tagged response of IDLE shows the session alive as NOOP does.
+  if (_idling) _done({});
+  else _command("NOOP");
+  return true;
+}
+
 size_t
 imap4::fetch(mailbox& mbox, uri const& uri)
 {
   auto& path = uri[uri::path];
-  _command("EXAMINE" + _arg(!path.empty() ? _utf7m(path) : "INBOX"));
+  _validity = 0, _highest = 0, _mapped = false;
+  _command("EXAMINE" + _arg(!path.empty() ? _utf7m(path) : "INBOX"),
+	   [this](response const& resp) {
+	     if (!_is(resp.type, "OK")) return;
+	     if (parser parse(resp.data); parse.peek() == '[') {
+	       parse = parse.token(true);
+	       auto code = parse.token(), value = parse.token();
+	       if (_is(code, "UIDVALIDITY")) _validity = static_cast<unsigned long>(_number(value));
+	       else if (_is(code, "HIGHESTMODSEQ")) _highest = _number(value);
+	     }
+	   });
   return _fetch(mbox);
 }
 
 size_t
 imap4::fetch(mailbox& mbox)
 {
-  _idle();
-  return _fetch(mbox);
+  return _mapped ? _update(mbox) : _fetch(mbox);
 }
 
 std::string
@@ -168,75 +226,324 @@ imap4::_arg(std::string_view arg)
   return esc + '"';
 }
 
+template<class It> std::string
+imap4::_uidset(It& it, It end)
+{
+  // collapse the UIDs into a sequence set such as "101:180,190".
+  constexpr size_t limit = 1000;
+  std::string set;
+  while (it != end && set.size() < limit) {
+    auto first = strtoul(it->c_str(), {}, 10), last = first;
+    for (++it; it != end && strtoul(it->c_str(), {}, 10) == last + 1; ++it) ++last;
+    if (!set.empty()) set += ',';
+    set += std::to_string(first);
+    if (last != first) set += ':' + std::to_string(last);
+  }
+  return set;
+}
+
+void
+imap4::_enable(std::string const& cap)
+{
+  auto enable = false, qresync = false, deflate = false;
+  for (parser caps(cap); caps;) {
+    auto s = caps.token();
+    enable = enable || _is(s, "ENABLE");
+    qresync = qresync || _is(s, "QRESYNC");
+    deflate = deflate || _is(s, "COMPRESS=DEFLATE");
+  }
+  if (deflate && backend::deflate()) _command("COMPRESS DEFLATE"), compress();
+  if (!enable || !qresync) return;
+  for (parser caps(_command("ENABLE QRESYNC", "ENABLED")); caps;) {
+    _qresync = _qresync || _is(caps.token(), "QRESYNC");
+  }
+}
+
+size_t
+imap4::_recents(std::vector<std::string> uids, maillist& mails)
+{
+  // the UIDs are sorted to be collapsed into the ranges.
+  std::sort(uids.begin(), uids.end(), [](auto const& a, auto const& b) {
+    return a.size() != b.size() ? a.size() < b.size() : a < b;
+  });
+  std::unordered_map<std::string, mail> fetched;
+  for (auto p = uids.cbegin(); p != uids.cend();) {
+    auto set = _uidset(p, uids.cend());
+    LOG("Fetch mails: " << set << std::endl);
+    _command("UID FETCH " + set + " (UID BODY.PEEK[HEADER.FIELDS (SUBJECT FROM DATE)])",
+	     [&fetched](response const& resp) {
+	       if (!_is(resp.type, "FETCH")) return;
+	       parser parse(resp.data);
+	       if (parse.peek() != '(') throw mailbox::error(resp.text());
+	       constexpr std::string_view fields("BODY[HEADER.FIELDS (");
+	       std::string uid, headers;
+	       auto body = false;
+	       for (parse = parse.token(true); parse;) {
+		 auto item = parse.token(), value = parse.token();
+		 if (_is(item, "UID")) uid = value;
+		 else if (_is(item.substr(0, fields.size()), fields)) headers = value, body = true;
+	       }
+	       if (uid.empty() || !body) return;
+	       mail m(uid);
+	       m.header(headers);
+	       fetched.insert_or_assign(uid, m);
+	     });
+  }
+  auto count = mails.size();
+  for (auto const& uid : uids) {
+    if (auto p = fetched.find(uid); p != fetched.end()) mails.push_back(p->second);
+  }
+  return mails.size() - count;
+}
+
 size_t
 imap4::_fetch(mailbox& mbox)
 {
-  std::list<mail> mails, recents;
-  for (parser ids(_command("UID SEARCH UNSEEN", "SEARCH")); ids;) {
-    auto uid = ids.token();
-    if (auto p = mbox.find(uid); p) {
-      mails.push_back(*p);
-      continue;
+  if (auto [validity, modseq] = mbox.modseq(); _qresync && modseq && validity == _validity) {
+    return _sync(mbox, modseq);
+  }
+  if (!_idletag.empty()) _map(); // for the following IDLE.
+  maillist mails;
+  std::vector<std::string> uids;
+  _command("UID SEARCH UNSEEN", [&](response const& resp) {
+    if (!_is(resp.type, "SEARCH")) return;
+    for (parser ids(resp.data); ids;) {
+      std::string uid(ids.token());
+      if (auto p = mbox.find(uid); p) mails.push_back(*p);
+      else uids.push_back(uid);
+    }
+  });
+  auto count = _recents(std::move(uids), mails);
+  auto lock = mbox.lock();
+  mbox.mails(mails);
+  mbox.modseq(_validity, _highest);
+  return count;
+}
+
+size_t
+imap4::_sync(mailbox& mbox, unsigned long long modseq)
+{
+  // fetch only the changes since the last synchronization (RFC 7162).
+  std::vector<std::pair<unsigned long, unsigned long>> vanished;
+  std::unordered_map<std::string, bool> changed; // UID and \Seen flag.
+  auto highest = modseq;
+  _command("UID FETCH 1:* (FLAGS) (CHANGEDSINCE " + std::to_string(modseq) + " VANISHED)",
+	   [&](response const& resp) {
+	     if (_is(resp.type, "VANISHED")) {
+	       parser parse(resp.data);
+	       if (parse.peek() == '(') parse.token(); // drop (EARLIER)
+	       for (auto set = parse.token(); !set.empty();) {
+		 auto i = set.find(',');
+		 auto range = set.substr(0, i);
+		 set.remove_prefix(i != set.npos ? i + 1 : set.size());
+		 auto j = range.find(':');
+		 auto first = static_cast<unsigned long>(_number(range.substr(0, j)));
+		 auto last = j != range.npos ? static_cast<unsigned long>(_number(range.substr(j + 1))) : first;
+		 vanished.emplace_back(min(first, last), max(first, last));
+	       }
+	     } else if (_is(resp.type, "FETCH")) {
+	       parser parse(resp.data);
+	       if (parse.peek() != '(') throw mailbox::error(resp.text());
+	       std::string uid;
+	       auto seen = false;
+	       for (parse = parse.token(true); parse;) {
+		 auto item = parse.token(), value = parse.token();
+		 if (_is(item, "UID")) {
+		   uid = value;
+		 } else if (_is(item, "FLAGS")) {
+		   for (parser flags(parser(value).token(true)); flags;) {
+		     seen = seen || _is(flags.token(), "\\SEEN");
+		   }
+		 } else if (_is(item, "MODSEQ")) {
+		   highest = max(highest, _number(parser(value).token(true)));
+		 }
+	       }
+	       if (!uid.empty()) changed.insert_or_assign(uid, seen);
+	     }
+	   });
+  // merge the vanished ranges in order to be searched.
+  std::sort(vanished.begin(), vanished.end());
+  size_t n = 0;
+  for (auto const& range : vanished) {
+    if (n && range.first <= vanished[n - 1].second) {
+      vanished[n - 1].second = max(vanished[n - 1].second, range.second);
+    } else {
+      vanished[n++] = range;
     }
-    LOG("Fetch mail: " << uid << std::endl);
-    parser parse(_command("UID FETCH " + uid +
-			  " BODY.PEEK[HEADER.FIELDS (SUBJECT FROM DATE)]",
-			  "FETCH"));
-    parse.token(); // drop sequence#
-    if (parse.peek() != '(') throw mailbox::error(parse.data());
+  }
+  vanished.resize(n);
+  maillist mails;
+  for (auto const& m : mbox.mails()) {
+    if (auto p = changed.find(m.uid()); p != changed.end() && p->second) continue;
+    auto uid = strtoul(m.uid().c_str(), {}, 10);
+    auto p = std::upper_bound(vanished.cbegin(), vanished.cend(), uid,
+			      [](auto uid, auto const& range) { return uid < range.first; });
+    if (p == vanished.cbegin() || uid > (--p)->second) mails.push_back(m);
+  }
+  std::vector<std::string> uids;
+  for (auto const& [uid, seen] : changed) {
+    if (!seen && !mbox.find(uid)) uids.push_back(uid);
+  }
+  auto count = _recents(std::move(uids), mails);
+  auto lock = mbox.lock();
+  mbox.mails(mails);
+  mbox.modseq(_validity, _highest = highest);
+  return count;
+}
+
+void
+imap4::_map()
+{
+  _mapped = false, _changed.clear(), _expunged.clear();
+  std::vector<unsigned long> uids;
+  _command("UID SEARCH ALL", [&uids](response const& resp) {
+    if (!_is(resp.type, "SEARCH")) return;
+    for (parser ids(resp.data); ids;) {
+      uids.push_back(static_cast<unsigned long>(_number(ids.token())));
+    }
+  });
+  std::sort(uids.begin(), uids.end());
+  _uids.swap(uids);
+  _mapped = _uids.size() == _exists;
+}
+
+void
+imap4::_track(response const& resp)
+{
+  if (resp.tag != "*" || _qresync) return;
+  auto n = resp.number;
+  if (_is(resp.type, "EXISTS")) {
+    _exists = n;
+  } else if (_is(resp.type, "EXPUNGE")) {
+    if (_exists) --_exists;
+    if (!_mapped || n > _uids.size()) return; // not mapped yet.
+    if (n == 0) return void(_mapped = false);
+    _expunged.insert(std::to_string(_uids[n - 1]));
+    _uids.erase(_uids.begin() + (n - 1));
+  } else if (_is(resp.type, "FETCH") && _mapped) {
+    parser parse(resp.data);
+    if (parse.peek() != '(') return;
+    std::string uid;
+    auto flags = false, seen = false;
     for (parse = parse.token(true); parse;) {
       auto item = parse.token(), value = parse.token();
-      if (item.starts_with("BODY[HEADER.FIELDS (")) {
-	mail m(uid);
-	m.header(value);
-	recents.push_back(m);
-	break;
+      if (_is(item, "UID")) {
+	uid = value;
+      } else if (_is(item, "FLAGS")) {
+	flags = true;
+	for (parser fl(parser(value).token(true)); fl;) seen = seen || _is(fl.token(), "\\SEEN");
       }
     }
+    if (n == _uids.size() + 1 && !uid.empty()) {
+      _uids.push_back(static_cast<unsigned long>(_number(uid))); // a new message.
+    } else if (n == 0 || n > _uids.size()) {
+      return;
+    } else if (uid.empty()) {
+      uid = std::to_string(_uids[n - 1]);
+    } else if (_number(uid) != _uids[n - 1]) {
+      return void(_mapped = false);
+    }
+    if (flags) _changed.insert_or_assign(uid, seen);
+  }
+}
+
+size_t
+imap4::_update(mailbox& mbox)
+{
+  // apply the changes notified while idling, instead of searching.
+  if (_exists > _uids.size()) {
+    _command("FETCH " + std::to_string(_uids.size() + 1) + ":* (UID FLAGS)");
+  }
+  if (!_mapped || _uids.size() != _exists) return _fetch(mbox);
+  auto changed = std::move(_changed);
+  auto expunged = std::move(_expunged);
+  _changed.clear(), _expunged.clear();
+  maillist mails;
+  for (auto const& m : mbox.mails()) {
+    if (auto p = changed.find(m.uid()); p != changed.end() && p->second) continue;
+    if (!expunged.contains(m.uid())) mails.push_back(m);
   }
-  auto count = recents.size();
-  mails.splice(mails.end(), recents);
+  std::vector<std::string> uids;
+  for (auto const& [uid, seen] : changed) {
+    if (!seen && !mbox.find(uid)) uids.push_back(uid);
+  }
+  auto count = _recents(std::move(uids), mails);
   auto lock = mbox.lock();
   mbox.mails(mails);
+  mbox.modseq(_validity, _highest);
   return count;
 }
 
-void
-imap4::_idle()
+bool
+imap4::_event(response const& resp)
 {
-  auto const tag = _tag();
-  write(tag + " IDLE");
-  LOG("S: " << tag << " IDLE" << std::endl);
+  for (auto type : { "RECENT", "EXISTS", "EXPUNGE", "FETCH", "VANISHED" }) {
+    if (_is(resp.type, type)) return true;
+  }
+  return false;
+}
+
+unsigned
+imap4::idle()
+{
+  // start IDLE, and the caller waits for the events without reading.
+  _idletag = _tag();
+  write(_idletag + " IDLE");
+  LOG("S: " << _idletag << " IDLE" << std::endl);
+  for (;;) {
+    auto resp = _response();
+    if (resp.tag == "+") break;
+    if (resp.tag != "*") throw mailbox::error(resp.text());
+    _track(resp);
+    _notified = _notified || _event(resp);
+  }
+  _idling = true, _idlesince = time({});
+  return IDLE_LIMIT;
+}
 
+unsigned
+imap4::wake()
+{
+  auto left = [this]() -> unsigned {
+    auto t = time({}) - _idlesince;
+    return t >= 0 && t < IDLE_LIMIT ? unsigned(IDLE_LIMIT - t) : 0;
+  };
+  auto done = std::exchange(_notified, false);
+  auto expired = !left();
   response resp;
-  auto idling = false, done = false;
-  for (auto t = time({}); time({}) - t < 1680 && idling + done < 2;) {
+  while (!done && !expired) {
     try {
       resp = _response();
-      if (resp.tag == "*") {
-	for (auto type : { "RECENT", "EXISTS", "EXPUNGE", "FETCH" }) {
-	  done = done || resp.type == type;
-	}
-      } else if (resp.tag == "+") {
-	if (idling) throw mailbox::error("unexcepted continuation request");
-	idling = true;
-      } else break;
     } catch (mailbox::silent const&) {
       LOG("..." << std::endl);
+      expired = true;
+      break;
     }
+    if (resp.tag != "*") break;
+    _track(resp);
+    done = _event(resp);
+    if (!done && !backend::pending()) return max(left(), 1U); // still idling.
   }
-  if (idling) {
+  _done(resp);
+  return 0;
+}
+
+void
+imap4::_done(response resp)
+{
+  // finish IDLE unless the server has finished it.
+  if (resp.tag.empty() || resp.tag == "*") {
     write("DONE");
     LOG("S: DONE" << std::endl);
-    if (resp.tag == "+") resp = _response();
-    while (resp.tag == "*") resp = _response();
+    while ((resp = _response()).tag == "*") _track(resp);
   }
-  if (resp.tag != tag) throw mailbox::error("unexpected tagged response");
-  if (resp.type != "OK") throw mailbox::error(resp.type + ' ' + resp.data);
+  _idling = false;
+  if (resp.tag != _idletag) throw mailbox::error("unexpected tagged response");
+  if (!_is(resp.type, "OK")) throw mailbox::error(resp.text());
 }
 
-std::string
-imap4::_command(std::string_view cmd, std::string_view res)
+imap4::response
+imap4::_command(std::string_view cmd, untagged const& untagged)
 {
   auto const tag = _tag();
   // send a command message to the server.
@@ -244,136 +551,162 @@ imap4::_command(std::string_view cmd, std::string_view res)
   LOG("S: " << tag << " " << cmd << std::endl);
 
   response resp;
-  std::string untagged;
   for (auto logout = cmd == "LOGOUT";;) {
     resp = _response(logout);
-    if (!res.empty() && resp.type == "OK") {
+    if (resp.tag != "*") break;
+    _track(resp);
+    untagged(resp);
+  }
+  if (resp.tag != tag) throw mailbox::error("unexpected tagged response");
+  if (!_is(resp.type, "OK")) throw mailbox::error(resp.text());
+  return resp;
+}
+
+std::string
+imap4::_command(std::string_view cmd, std::string_view res)
+{
+  std::string untagged;
+  auto code = [&](response const& resp) {
+    if (!res.empty() && _is(resp.type, "OK")) {
       if (parser parse(resp.data); parse.peek() == '[') {
 	parse = parse.token(true);
-	if (parse.token() == res) untagged = parse.remain();
+	if (_is(parse.token(), res)) untagged = parse.remain();
       }
     }
-    if (resp.tag != "*") break;
-    if (!res.empty() && resp.type == res) untagged = resp.data;
-  }
-  if (resp.tag != tag) throw mailbox::error("unexpected tagged response");
-  if (resp.type != "OK") throw mailbox::error(resp.type + ' ' + resp.data);
+  };
+  code(_command(cmd, [&](response const& resp) {
+    code(resp);
+    if (!res.empty() && _is(resp.type, res)) untagged = resp.data;
+  }));
   return untagged;
 }
 
 imap4::response
 imap4::_response(bool logout)
 {
-  parser parse(_read());
+  auto line = _read();
+  parser parse(line);
   response resp;
   if (resp.tag = parse.token(); resp.tag != "+") {
     resp.type = parse.token();
     if (resp.tag.empty() || resp.type.empty()) {
-      throw mailbox::error("unexpected response: " + parse.data());
+      throw mailbox::error("unexpected response: " + std::string(line));
     }
-    if (!logout && resp.tag == "*" && resp.type == "BYE") {
+    if (!logout && resp.tag == "*" && _is(resp.type, "BYE")) {
       throw mailbox::error("bye");
     }
-    if (parse && parser::digit(resp.type)) {
-      resp.data = resp.type, resp.type = parse.token();
+    if (parse && tokenizer::digit(resp.type)) {
+      resp.number = static_cast<unsigned long>(_number(resp.type));
+      resp.type = parse.token();
     }
-    if (parse) {
-      if (!resp.data.empty()) resp.data += ' ';
-      resp.data += parse.remain();
-    }
-  } else {
-    resp.data = parse.remain();  // continuation
   }
+  resp.data = parse.remain();
   return resp;
 }
 
-std::string
+std::string_view
 imap4::_read()
 {
-  auto line = read();
-  if (!line.empty() && line[0] != '+') {
-    while (line[line.size() - 1] == '}') {
-      auto i = line.find_last_of('{');
-      if (i == line.npos) break;
-      auto p = line.c_str();
-      char* end;
-      auto size = strtoul(p + i + 1, &end, 10);
-      if (static_cast<size_t>(end - p) != line.size() - 1) break;
-      if (size) { // read literal data.
-	auto literal = read(size);
-	LOG(literal);
-	line += literal;
-      }
-      line += read(); // read a following line.
+  // the line is the view of the received data unless it has literals.
+  auto line = readln();
+  LOG("R: " << line << std::endl);
+  size_t size;
+  if (line.starts_with('+') || !_literal(line, size)) return line;
+  _line = line;
+  do {
+    if (size) { // read literal data into the line.
+      auto n = _line.size();
+      _line.resize(n + size);
+      read(_line.data() + n, size);
+      LOG(std::string_view(_line).substr(n));
     }
-  }
-  return line;
+    auto following = readln();
+    LOG("R: " << following << std::endl);
+    _line += following;
+  } while (_literal(_line, size));
+  return _line;
+}
+
+bool
+imap4::_literal(std::string_view line, size_t& size) noexcept
+{
+  // the line ends with "{size}" followed by the literal data.
+  if (!line.ends_with('}')) return false;
+  auto i = line.find_last_of('{');
+  if (i == line.npos || i + 2 >= line.size()) return false;
+  auto const end = line.data() + line.size() - 1;
+  auto [p, ec] = std::from_chars(line.data() + i + 1, end, size);
+  return ec == std::errc() && p == end;
+}
+
+unsigned long long
+imap4::_number(std::string_view s) noexcept
+{
+  unsigned long long value = 0;
+  std::from_chars(s.data(), s.data() + s.size(), value);
+  return value;
 }
 
 /*
  * Functions of the class imap4::parser
  */
-std::string
-imap4::parser::token(bool open)
+size_t
+imap4::parser::_skip(size_t i) const
 {
-  if (!*this) {};
-  char delim[] = " [(\"{";
-  auto i = findf(delim);
-  auto result = uppercase(i);
-  if (i == _s.npos) {
-    _next = _s.size();
-  } else if (_s[i] == ' ') {
-    _next = i + 1;
-  } else if (_s[i] == '[' || result.empty()) {
-    result += _s[i];
-    for (std::string st(1, _s[i++]); !st.empty();) {
-      _next = i;
-      if (_next >= _s.size()) throw mailbox::error("invalid token: " + _s);
-      auto sp = st.size() - 1;
-      switch (st[sp]) {
-      case '"':
-	if (i = findq("\"", i); i != _s.npos) {
-	  result.append(_s, _next, ++i - _next);
-	  st.erase(sp);
-	}
-	break;
-      case '{':
-	{
-	  auto p = _s.c_str();
-	  char* end;
-	  i = strtoul(p + i, &end, 10);
-	  i += std::string::size_type(end - p) + 1;
-	  if (*end == '}' && i <= _s.size()) {
-	    result.append(_s, _next, i - _next);
-	    st.erase(sp);
-	  } else {
-	    i = _s.npos;
-	  }
-	}
-	break;
-      default:
-	delim[0] = st[sp] == '[' ? ']' : ')';
-	if (i = findf(delim, i); i != _s.npos) {
-	  if (_s[i] == delim[0]) st.erase(sp);
-	  else st.push_back(_s[i]);
-	  result += uppercase(++i);
+  // skip the nested lists, the quoted strings and the literals at once.
+  for (unsigned nest = 0;;) {
+    if (i >= _s.size()) throw mailbox::error("invalid token: " + std::string(_s));
+    switch (_s[i++]) {
+    case '(': case '[':
+      ++nest;
+      continue;
+    case ')': case ']':
+      if (nest) --nest;
+      break;
+    case '"':
+      for (;; i += 2) {
+	i = _s.find_first_of("\"\\", i);
+	if (i == _s.npos) throw mailbox::error("invalid token: " + std::string(_s));
+	if (_s[i] == '"') break;
+      }
+      ++i;
+      break;
+    case '{':
+      {
+	size_t size;
+	auto const p = _s.data() + i, end = _s.data() + _s.size();
+	auto [q, ec] = std::from_chars(p, end, size);
+	if (ec != std::errc() || q == end || *q != '}' ||
+	    size > size_t(end - q - 1)) {
+	  throw mailbox::error("invalid token: " + std::string(_s));
 	}
-	break;
+	i += q - p + 1 + size;
       }
+      break;
     }
-    _next = i < _s.size() && _s[i] == ' ' ? i + 1 : i;
-    if (result.size() > 1) {
-      switch (result[0]) {
-      default:
-	if (!open || (result[0] != '(' && result[0] != '[')) break;
-      case '"':
-	result.assign(result, 1, result.size() - 2);
-	break;
-      case '{':
-	assert(result.find('}') != result.npos);
-	result.erase(0, result.find('}') + 1);
-	break;
-      }
+    if (!nest) return i;
+  }
+}
+
+std::string_view
+imap4::parser::token(bool open)
+{
+  // an atom, which may have a section such as BODY[TEXT], or an element.
+  auto i = _s.find_first_of(" [(\"{");
+  if (i == _s.npos) i = _s.size();
+  else if (_s[i] == '[' || (!i && _s[i] != ' ')) i = _skip(i);
+  auto result = _s.substr(0, i);
+  _s.remove_prefix(i < _s.size() && _s[i] == ' ' ? i + 1 : i);
+  if (result.size() > 1) {
+    switch (result[0]) {
+    default:
+      if (!open || (result[0] != '(' && result[0] != '[')) break;
+    case '"':
+      result = result.substr(1, result.size() - 2);
+      break;
+    case '{':
+      result.remove_prefix(result.find('}') + 1);
+      break;
     }
   }
   return result;
@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#include "inflate.h"
+#include <algorithm>
+#include <iterator>
+
+#define WINDOW_SIZE 32768
+
+namespace {
+  // base values and extra bits of the lengths and the distances.
+  unsigned short const lbase[] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+  };
+  unsigned char const lext[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+  };
+  unsigned short const dbase[] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577,
+  };
+  unsigned char const dext[] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+  };
+}
+
+/*
+ * Functions of the class inflater
+ */
+void
+inflater::_huffman::build(unsigned char const* lengths, int n)
+{
+  std::fill(std::begin(count), std::end(count), short(0));
+  for (int i = 0; i < n; ++i) ++count[lengths[i]];
+  for (int len = 1, left = 1; len < 16; ++len) {
+    left = (left << 1) - count[len];
+    if (left < 0) throw error("over-subscribed code");
+  }
+  short offs[16] = {};
+  for (int len = 1; len < 15; ++len) offs[len + 1] = offs[len] + count[len];
+  for (int i = 0; i < n; ++i) {
+    if (lengths[i]) symbol[offs[lengths[i]]++] = short(i);
+  }
+  // the codes up to 9 bits are looked up at once. the table is indexed
+  // by the bits in the stream order, so the codes are reversed.
+  std::fill(std::begin(fast), std::end(fast), static_cast<unsigned short>(0));
+  unsigned next[16] = {};
+  for (int len = 2, code = 0; len < 16; ++len) next[len] = code = (code + count[len - 1]) << 1;
+  for (int i = 0; i < n; ++i) {
+    int const len = lengths[i];
+    if (!len) continue;
+    auto const code = next[len]++;
+    if (len > 9) continue;
+    unsigned rev = 0;
+    for (int b = 0; b < len; ++b) rev |= (code >> b & 1) << (len - 1 - b);
+    for (auto j = rev; j < 512; j += 1U << len) fast[j] = static_cast<unsigned short>(i | len << 9);
+  }
+}
+
+unsigned
+inflater::_bits(int n) noexcept
+{
+  unsigned v = 0;
+  for (int i = 0; i < n; ++i, ++_pos) {
+    v |= (static_cast<unsigned char>(_in[_pos >> 3]) >> (_pos & 7) & 1U) << i;
+  }
+  return v;
+}
+
+int
+inflater::_decode(_huffman const& h) noexcept
+{
+  if (_have(9)) {
+    auto const i = _pos >> 3;
+    unsigned const bits = (static_cast<unsigned char>(_in[i]) |
+			   static_cast<unsigned char>(_in[i + 1]) << 8) >> (_pos & 7) & 511;
+    if (auto e = h.fast[bits]; e) return _pos += e >> 9, e & 511;
+  }
+  return _slow(h);
+}
+
+int
+inflater::_slow(_huffman const& h) noexcept
+{
+  // canonical codes are decoded bit by bit (see puff.c in zlib).
+  int code = 0, first = 0, index = 0;
+  for (int len = 1; len < 16; ++len) {
+    if (!_have(1)) return -1;
+    code |= _bits(1);
+    int count = h.count[len];
+    if (code - count < first) return h.symbol[index + (code - first)];
+    index += count, first += count;
+    first <<= 1, code <<= 1;
+  }
+  return -2;
+}
+
+bool
+inflater::_header()
+{
+  auto const pos = _pos;
+  if (!_have(3)) return false;
+  _final = _bits(1) != 0;
+  switch (_bits(2)) {
+  case 0:
+    _pos = (_pos + 7) & ~size_t(7);
+    if (!_have(32)) return _pos = pos, false;
+    _stored = _bits(16);
+    if (_stored != (~_bits(16) & 0xffff)) throw error("invalid stored block");
+    _state = STORED;
+    return true;
+  case 1:
+    {
+      unsigned char lengths[288 + 30];
+      std::fill(lengths, lengths + 144, 8);
+      std::fill(lengths + 144, lengths + 256, 9);
+      std::fill(lengths + 256, lengths + 280, 7);
+      std::fill(lengths + 280, lengths + 288, 8);
+      std::fill(lengths + 288, lengths + 288 + 30, 5);
+      _lit.build(lengths, 288), _dist.build(lengths + 288, 30);
+    }
+    _state = CODES;
+    return true;
+  case 2:
+    if (!_dynamic()) return _pos = pos, false;
+    _state = CODES;
+    return true;
+  }
+  throw error("invalid block type");
+}
+
+bool
+inflater::_dynamic()
+{
+  if (!_have(14)) return false;
+  int const nlen = _bits(5) + 257, ndist = _bits(5) + 1, ncode = _bits(4) + 4;
+  if (nlen > 286 || ndist > 30) throw error("invalid code lengths");
+  if (!_have(ncode * 3)) return false;
+  static unsigned char const order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
+  };
+  unsigned char lengths[286 + 30] = {};
+  for (int i = 0; i < ncode; ++i) lengths[order[i]] = static_cast<unsigned char>(_bits(3));
+  _huffman lencode;
+  lencode.build(lengths, 19);
+  std::fill(lengths, lengths + 19, 0);
+  for (int i = 0; i < nlen + ndist;) {
+    auto sym = _decode(lencode);
+    if (sym == -1) return false;
+    if (sym < 0) throw error("invalid code lengths");
+    if (sym < 16) {
+      lengths[i++] = static_cast<unsigned char>(sym);
+      continue;
+    }
+    unsigned char len = 0;
+    int rep;
+    if (sym == 16) {
+      if (i == 0) throw error("invalid code lengths");
+      if (!_have(2)) return false;
+      len = lengths[i - 1], rep = 3 + _bits(2);
+    } else if (sym == 17) {
+      if (!_have(3)) return false;
+      rep = 3 + _bits(3);
+    } else {
+      if (!_have(7)) return false;
+      rep = 11 + _bits(7);
+    }
+    if (i + rep > nlen + ndist) throw error("invalid code lengths");
+    while (rep--) lengths[i++] = len;
+  }
+  if (!lengths[256]) throw error("no end of block");
+  _lit.build(lengths, nlen), _dist.build(lengths + nlen, ndist);
+  return true;
+}
+
+bool
+inflater::_codes()
+{
+  for (;;) {
+    auto const pos = _pos;
+    auto sym = _decode(_lit);
+    if (sym == -1) return _pos = pos, false;
+    if (sym < 0) throw error("invalid literal/length code");
+    if (sym < 256) {
+      _out += static_cast<char>(sym);
+      continue;
+    }
+    if (sym == 256) return _state = _final ? END : HEADER, true;
+    if ((sym -= 257) >= 29) throw error("invalid length code");
+    if (!_have(lext[sym])) return _pos = pos, false;
+    size_t len = lbase[sym] + _bits(lext[sym]);
+    auto ds = _decode(_dist);
+    if (ds == -1) return _pos = pos, false;
+    if (ds < 0 || ds >= 30) throw error("invalid distance code");
+    if (!_have(dext[ds])) return _pos = pos, false;
+    size_t dist = dbase[ds] + _bits(dext[ds]);
+    if (dist > _out.size()) throw error("invalid distance");
+    for (auto i = _out.size() - dist; len--; ++i) _out += _out[i];
+  }
+}
+
+std::string_view
+inflater::inflate(std::string_view data)
+{
+  // drop the consumed data, and keep the window for the distances.
+  _in.erase(0, _pos >> 3), _pos &= 7;
+  _in.append(data);
+  if (_out.size() > WINDOW_SIZE) _out.erase(0, _out.size() - WINDOW_SIZE);
+  auto const start = _out.size();
+  for (auto more = true; more;) {
+    switch (_state) {
+    case HEADER:
+      more = _header();
+      break;
+    case STORED:
+      {
+	auto n = std::min(_stored, _in.size() - (_pos >> 3));
+	_out.append(_in, _pos >> 3, n);
+	_pos += n * 8, _stored -= n;
+	if (!_stored) _state = _final ? END : HEADER;
+	more = !_stored;
+      }
+      break;
+    case CODES:
+      more = _codes();
+      break;
+    default:
+      _in.clear(), _pos = 0;
+      more = false;
+    }
+  }
+  return std::string_view(_out).substr(start);
+}
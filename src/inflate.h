@@ -0,0 +1,44 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/** inflater - decoder of raw DEFLATE stream (RFC 1951).
+ * The compressed data is given in pieces, and the decoder keeps the
+ * incomplete symbol until the following data is given.
+ */
+class inflater {
+  struct _huffman {
+    short count[16];  // number of codes of each length.
+    short symbol[288];
+    unsigned short fast[512]; // symbol | length << 9 by the next 9 bits, or 0.
+    void build(unsigned char const* lengths, int n);
+  };
+  std::string _in;     // compressed data not consumed yet.
+  size_t _pos = 0;     // bit position in _in.
+  std::string _out;    // the window followed by the output.
+  enum { HEADER, STORED, CODES, END } _state = HEADER;
+  bool _final = false;
+  size_t _stored = 0;  // remaining size of the stored block.
+  _huffman _lit, _dist;
+  bool _have(size_t bits) const noexcept { return _pos + bits <= _in.size() * 8; }
+  unsigned _bits(int n) noexcept;
+  int _decode(_huffman const& h) noexcept;
+  int _slow(_huffman const& h) noexcept;
+  bool _header();
+  bool _dynamic();
+  bool _codes();
+public:
+  class error : public std::runtime_error {
+  public:
+    error(char const* msg) : std::runtime_error(msg) {}
+  };
+  std::string_view inflate(std::string_view data); // valid until the next call.
+};
@@ -0,0 +1,254 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#include "inifile.h"
+#include <fstream>
+#include <sstream>
+
+/*
+ * Functions of the class inifile
+ */
+std::string
+inifile::_fold(std::string_view s)
+{
+  std::string result(s);
+  for (auto& c : result) {
+    if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+  }
+  return result;
+}
+
+std::string_view
+inifile::_trim(std::string_view s) noexcept
+{
+  constexpr char ws[] = "\t ";
+  auto i = s.find_first_not_of(ws);
+  if (i == s.npos) return {};
+  return s.substr(i, s.find_last_not_of(ws) - i + 1);
+}
+
+inifile::_section*
+inifile::_find(std::string_view section) const
+{
+  auto p = _index.find(_fold(section));
+  return p != _index.end() ? &*p->second : nullptr;
+}
+
+void
+inifile::_parse(std::string_view text)
+{
+  _preamble.clear(), _sections.clear(), _index.clear();
+  _section* sect = {};
+  while (!text.empty()) {
+    auto n = text.find('\n');
+    auto ln = text.substr(0, n);
+    text = n != text.npos ? text.substr(n + 1) : std::string_view();
+    if (!ln.empty() && ln.back() == '\r') ln.remove_suffix(1);
+    auto t = _trim(ln);
+    if (!t.empty() && t[0] == '[') {
+      auto e = t.find(']');
+      auto name = t.substr(1, e != t.npos ? e - 1 : t.npos);
+      _sections.push_back({ std::string(name) });
+      sect = &_sections.back();
+      _index.emplace(_fold(name), --_sections.end()); // first one wins.
+      continue;
+    }
+    if (!sect) {
+      _preamble.append(ln).append("\r\n");
+      continue;
+    }
+    auto eq = t.find('=');
+    auto key = _trim(t.substr(0, eq));
+    if (t.empty() || t[0] == ';' || eq == t.npos || key.empty()) {
+      sect->lines.push_back({ {}, std::string(ln) });
+      continue;
+    }
+    sect->lines.push_back({ std::string(key), std::string(_trim(t.substr(eq + 1))) });
+    sect->index.emplace(_fold(key), --sect->lines.end());
+  }
+}
+
+std::string
+inifile::get(std::string_view section, std::string_view key) const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto sect = _find(section);
+  if (!sect) return {};
+  auto p = sect->index.find(_fold(key));
+  if (p == sect->index.end()) return {};
+  std::string_view v = p->second->value;
+  if (v.size() >= 2 && (v[0] == '"' || v[0] == '\'') && v.back() == v[0]) {
+    v = v.substr(1, v.size() - 2); // the spaces in the quotes are kept.
+  }
+  return std::string(v);
+}
+
+void
+inifile::put(std::string_view section, std::string_view key, std::string_view value)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto sect = _find(section);
+  if (!sect) {
+    _sections.push_back({ std::string(section) });
+    sect = &_sections.back();
+    _index.emplace(_fold(section), --_sections.end());
+  }
+  auto k = _fold(key);
+  if (auto p = sect->index.find(k); p != sect->index.end()) {
+    if (p->second->value == value) return;
+    p->second->value = value;
+  } else {
+    // insert the entry before trailing blank lines.
+    auto pos = sect->lines.end();
+    while (pos != sect->lines.begin() &&
+	   std::prev(pos)->key.empty() && _trim(std::prev(pos)->value).empty()) --pos;
+    pos = sect->lines.insert(pos, { std::string(key), std::string(value) });
+    sect->index.emplace(k, pos);
+  }
+  _modified();
+}
+
+void
+inifile::erase(std::string_view section, std::string_view key)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto sect = _find(section);
+  if (!sect) return;
+  auto p = sect->index.find(_fold(key));
+  if (p == sect->index.end()) return;
+  sect->lines.erase(p->second);
+  sect->index.erase(p);
+  _modified();
+}
+
+void
+inifile::erase(std::string_view section)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto k = _fold(section);
+  if (_index.erase(k) == 0) return;
+  for (auto p = _sections.begin(); p != _sections.end();) {
+    p = _fold(p->name) == k ? _sections.erase(p) : ++p;
+  }
+  _modified();
+}
+
+std::list<std::string>
+inifile::keys(std::string_view section) const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  std::list<std::string> result;
+  if (auto sect = _find(section); sect) {
+    for (auto const& ln : sect->lines) {
+      if (!ln.key.empty()) result.push_back(ln.key);
+    }
+  }
+  return result;
+}
+
+std::list<std::string>
+inifile::sections() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  std::list<std::string> result;
+  for (auto const& sect : _sections) result.push_back(sect.name);
+  return result;
+}
+
+bool
+inifile::dirty() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _dirty;
+}
+
+unsigned long
+inifile::generation() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _generation;
+}
+
+void
+inifile::parse(std::string_view text)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _parse(text);
+  _modified();
+}
+
+std::string
+inifile::_text() const
+{
+  auto result = _preamble;
+  for (auto const& sect : _sections) {
+    result.append("[").append(sect.name).append("]\r\n");
+    for (auto const& ln : sect.lines) {
+      if (!ln.key.empty()) result.append(ln.key).append("=");
+      result.append(ln.value).append("\r\n");
+    }
+  }
+  return result;
+}
+
+std::string
+inifile::text() const
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _text();
+}
+
+bool
+inifile::load()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (_path.empty()) return false;
+  std::error_code ec;
+  auto mtime = std::filesystem::last_write_time(_path, ec);
+  std::ifstream in(_path, std::ios::binary);
+  if (!in) return false;
+  std::ostringstream buf;
+  buf << in.rdbuf();
+  _parse(buf.str());
+  _mtime = mtime, _dirty = false, ++_generation;
+  return true;
+}
+
+bool
+inifile::refresh()
+{
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::error_code ec;
+    if (_dirty || _path.empty() ||
+	std::filesystem::last_write_time(_path, ec) == _mtime || ec) return false;
+  }
+  return load();
+}
+
+bool
+inifile::flush()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (!_dirty || _path.empty()) return !_dirty;
+  auto data = _text();
+  // write to a temporary file, and replace the file with it atomically.
+  auto tmp = _path + ".tmp";
+  std::error_code ec;
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if (!(out.write(data.data(), data.size()) && out.flush())) {
+      out.close();
+      std::filesystem::remove(tmp, ec);
+      return false;
+    }
+  }
+  std::filesystem::rename(tmp, _path, ec);
+  if (ec) return std::filesystem::remove(tmp, ec), false;
+  _mtime = std::filesystem::last_write_time(_path, ec);
+  _dirty = false;
+  return true;
+}
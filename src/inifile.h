@@ -0,0 +1,68 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#pragma once
+
+#include <filesystem>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/** inifile - in-memory model of an .INI file.
+ * The file is parsed once, and written back only by flush() when it
+ * has been modified. Sections and keys are case-insensitive like
+ * GetPrivateProfileString, and the order of the lines, comments and
+ * blank lines are kept as is.
+ */
+class inifile {
+  struct _line {
+    std::string key;   // empty for a comment or a blank line.
+    std::string value; // the raw value, or the whole line.
+  };
+  using _linelist = std::list<_line>;
+  struct _section {
+    std::string name;
+    _linelist lines;
+    std::unordered_map<std::string, _linelist::iterator> index;
+  };
+  using _sectionlist = std::list<_section>;
+  std::string _path;
+  std::string _preamble; // lines before the first section.
+  _sectionlist _sections;
+  std::unordered_map<std::string, _sectionlist::iterator> _index;
+  bool _dirty = false;
+  unsigned long _generation = 0;
+  std::filesystem::file_time_type _mtime;
+  mutable std::mutex _mutex;
+  static std::string _fold(std::string_view s);
+  static std::string_view _trim(std::string_view s) noexcept;
+  _section* _find(std::string_view section) const;
+  void _parse(std::string_view text);
+  std::string _text() const;
+  void _modified() noexcept { _dirty = true, ++_generation; }
+public:
+  inifile() {}
+  explicit inifile(std::string const& path) : _path(path) { load(); }
+  inifile(inifile const&) = delete;
+  void operator=(inifile const&) = delete;
+public:
+  auto& path() const noexcept { return _path; }
+  std::string get(std::string_view section, std::string_view key) const;
+  void put(std::string_view section, std::string_view key, std::string_view value);
+  void erase(std::string_view section, std::string_view key);
+  void erase(std::string_view section);
+  std::list<std::string> keys(std::string_view section) const;
+  std::list<std::string> sections() const;
+  bool dirty() const;
+  unsigned long generation() const;
+  void parse(std::string_view text);
+  std::string text() const;
+  bool load();
+  bool refresh();
+  bool flush();
+};
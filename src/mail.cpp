@@ -5,6 +5,33 @@
  * the license terms, see the LICENSE.txt file included with the program.
  */
 #include "stdafx.h"
+#include "charset.h"
+
+namespace {
+  // values of the base64 and the hexadecimal digits, or -1 for the others.
+  constexpr struct _digits {
+    signed char b64[256], hex[256];
+    constexpr _digits() : b64(), hex() {
+      constexpr char s[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+      for (int i = 0; i < 256; ++i) b64[i] = hex[i] = -1;
+      for (int i = 0; i < 64; ++i) b64[s[i] & 255] = static_cast<signed char>(i);
+      for (int i = 0; i < 10; ++i) hex['0' + i] = static_cast<signed char>(i);
+      for (int i = 0; i < 6; ++i) hex['A' + i] = hex['a' + i] = static_cast<signed char>(10 + i);
+    }
+  } digits;
+
+  // days from 1970-01-01 to the date of the proleptic Gregorian calendar.
+  constexpr long long
+  days(int y, int m, int d) noexcept
+  {
+    y -= m <= 2;
+    long long const era = (y >= 0 ? y : y - 399) / 400;
+    int const yoe = y - int(era * 400);
+    int const doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    return era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+  }
+  static_assert(days(1970, 1, 1) == 0 && days(2000, 3, 1) == 11017);
+}
 
 /*
  * Functions of the class mail.
@@ -13,9 +40,10 @@ bool
 mail::header(std::string const& headers)
 {
   auto read = false;
+  static constexpr decoder::fieldset names { "SUBJECT", "FROM", "DATE", "STATUS" };
   decoder de(headers);
   while (de) {
-    switch (auto [n, field] = de.field({ "SUBJECT", "FROM", "DATE", "STATUS" }); n) {
+    switch (auto [n, field] = de.field(names); n) {
     case 0: _subject = decoder(field).unstructured(); break;
     case 1: _from = decoder(field).address(); break;
     case 2: _date = decoder(field).date(); break;
@@ -28,38 +56,39 @@ mail::header(std::string const& headers)
 /*
  * Functions of the class mail::decoder
  */
-std::pair<int, std::string>
-mail::decoder::field(std::initializer_list<char const*> names)
+std::pair<int, std::string_view>
+mail::decoder::field(fieldset const& names)
 {
   while (*this) {
-    auto i = findf(":\015");
-    if (i == _s.npos) {
-      _next = _s.size();
-      break;
-    }
-    if (_s[i] == ':') {
-      auto name = uppercase(i++);
-      auto n = 0u;
-      for (auto np : names) {
-	if (np == name) break;
-	++n;
+    // take a field, which ends at CRLF not followed by WSP.
+    auto const begin = _next;
+    auto end = begin;
+    auto folded = false;
+    for (;;) {
+      end = _s.find("\015\012", end);
+      if (end == _s.npos) {
+	_next = end = _s.size();
+	break;
       }
-      if (n < names.size()) {
-	_next = i;
-	std::string s;
-	do {
-	  i = _s.find("\015\012", _next);
-	  s.append(_s, _next, i - _next);
-	  _next = i == _s.npos ? _s.size() : i + 2;
-	} while (*this && (_s[_next] == ' ' || _s[_next] == '\t'));
-	return { n, std::string(trim(s)) };
+      _next = end + 2;
+      if (_next == _s.size() || (_s[_next] != ' ' && _s[_next] != '\t')) break;
+      end = _next, folded = true;
+    }
+    auto line = _s.substr(begin, end - begin);
+    auto i = line.find_first_of(":\015");
+    if (i == line.npos || line[i] != ':') continue;
+    auto n = names(line.substr(0, i));
+    if (n < 0) continue;
+    auto value = line.substr(i + 1);
+    if (folded) {
+      // unfold the value by removing CRLFs.
+      _unfolded.clear();
+      for (; (i = value.find("\015\012")) != value.npos; value.remove_prefix(i + 2)) {
+	_unfolded.append(value.substr(0, i));
       }
+      value = _unfolded.append(value);
     }
-    do {
-      i = _s.find("\015\012", i);
-      i = i != _s.npos ? i + 2 : _s.size();
-    } while (i < _s.size() && (_s[i] == ' ' || _s[i] == '\t'));
-    _next = i;
+    return { n, trim(value) };
   }
   return { -1, {} };
 }
@@ -98,53 +127,55 @@ mail::decoder::address()
 time_t
 mail::decoder::date()
 {
-  struct tm tms {};
+  // parse the date-time of RFC 5322 including the obsolete forms, and
+  // compute the time by the calendar without the time zone of the process.
+  int mday, mon = 12, year, hour, minute, sec = 0;
   {
     auto day = token(), month = token();
     if (month == ",") day = token(), month = token();
-    if (!digit(day, &tms.tm_mday)) return time_t(-1);
-    constexpr char mn[][4] = { 
-      "Jan", "Feb", "Mar", "Apr", "May", "Jun",
-      "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+    if (day.size() > 2 || !digit(day, &mday)) return time_t(-1);
+    constexpr char mn[][4] = {
+      "JAN", "FEB", "MAR", "APR", "MAY", "JUN",
+      "JUL", "AUG", "SEP", "OCT", "NOV", "DEC"
     };
-    int i = sizeof(mn) / sizeof(*mn);
-    while (i-- && month != mn[i]) continue;
-    if (i < 0) return time_t(-1);
-    tms.tm_mon = i;
+    while (mon-- && !equal(month, mn[mon])) continue;
+    if (mon < 0) return time_t(-1);
+  }
+  if (auto y = token(); y.size() > 4 || !digit(y, &year)) {
+    return time_t(-1);
+  } else if (y.size() < 4) {
+    year += y.size() <= 2 && year < 50 ? 2000 : 1900; // obs-year
   }
-  if (!digit(token(), &tms.tm_year)) return time_t(-1);
-  tms.tm_year -= 1900;
-  if (!digit(token(), &tms.tm_hour) ||
+  if (!digit(token(), &hour) ||
       token() != ":" ||
-      !digit(token(), &tms.tm_min)) return time_t(-1);
+      !digit(token(), &minute)) return time_t(-1);
   auto zone = token();
   if (zone == ":") {
-    if (!digit(token(), &tms.tm_sec)) return time_t(-1);
+    if (!digit(token(), &sec)) return time_t(-1);
     zone = token();
   }
+  if (mday < 1 || mday > 31 || hour > 23 || minute > 59 || sec > 60) return time_t(-1);
 
-  auto gmt = mktime(&tms);
-  if (gmt == time_t(-1)) return time_t(-1);
-  if (struct tm gm; gmtime_s(&gm, &gmt) == 0) {
-    gmt += tms.tm_sec - gm.tm_sec;
-    gmt += (tms.tm_min - gm.tm_min) * 60;
-    gmt += (tms.tm_hour - gm.tm_hour) * 3600;
-    if (tms.tm_mday != gm.tm_mday) gmt += 86400;
-  } else return time_t(-1);
-  int delta = 0;
-  if (!zone.empty()) {
-    if (zone[0] == '+' || zone[0] == '-') {
-      if (!digit(zone.substr(1), &delta)) return time_t(-1);
-      delta *= (zone[0] != '-') * 2 - 1;
-    } else if (zone.size() == 3 && zone[2] == 'T' &&
-	       (zone[1] == 'S' || zone[1] == 'D')) {
-      constexpr char z[] = "ECMP";
-      for (auto i = 0; !delta && z[i]; ++i) {
-	if (zone[0] == z[i]) delta = (i + (zone[1] == 'S') + 4) * -100;
+  int offset = 0; // minutes east of UTC.
+  if (!zone.empty() && (zone[0] == '+' || zone[0] == '-')) {
+    int hhmm;
+    if (zone.size() != 5 || !digit(zone.substr(1), &hhmm) || hhmm % 100 > 59) {
+      return time_t(-1);
+    }
+    offset = (hhmm / 100 * 60 + hhmm % 100) * (zone[0] == '-' ? -1 : 1);
+  } else if (zone.size() == 3 &&
+	     (equal(zone.substr(1), "ST") || equal(zone.substr(1), "DT"))) {
+    // obs-zone of North America. UT, GMT and the military zones are
+    // taken as UTC like the unknown zones.
+    constexpr char z[] = "ECMP";
+    for (auto i = 0; z[i]; ++i) {
+      if (equal(zone.substr(0, 1), { z + i, 1 })) {
+	offset = -(i + 5 - equal(zone.substr(1), "DT")) * 60;
       }
     }
   }
-  return gmt - (delta / 100 * 60 + delta % 100) * 60;
+  return time_t(days(year, mon + 1, mday)) * 86400 +
+    (hour * 60 + minute - offset) * 60 + sec;
 }
 
 std::string_view
@@ -162,7 +193,7 @@ mail::decoder::eword(size_type to)
 {
   if (auto i = _next; i < to) {
     _next = min(to, _s.size());
-    return eword(std::string_view(_s).substr(i, _next - i));
+    return eword(_s.substr(i, _next - i));
   }
   return {};
 }
@@ -196,7 +227,8 @@ mail::decoder::eword(std::string_view text)
       prefix = i, i += 2;
       int n = 0;
       for (; n < 3; ++n) {
-	constexpr char const* delim[] { "\t ()<>@,;:\"/[]?.=", delim[0], "\t ?" };
+	static constexpr char specials[] = "\t ()<>@,;:\"/[]?.=";
+	constexpr char const* delim[] { specials, specials, "\t ?" };
 	auto s = i;
 	i = text.find_first_of(delim[n], i);
 	if (i == text.npos || text[i] != '?') break;
@@ -219,7 +251,6 @@ mail::decoder::eword(std::string_view text)
     }
     if (decode) {
       try {
-	extern unsigned codepage(std::string_view);
 	result += conv.codepage(codepage(q[0]))(decode(q[2]));
       } catch (...) {
 	decode = {};
@@ -236,50 +267,48 @@ std::string
 mail::decoder::decodeB(std::string_view text)
 {
   if (text.size() & 3) throw -1;
-  std::string decode;
-  decode.reserve(text.size() / 4 * 3);
-  for (; !text.empty(); text = text.substr(4)) {
-    unsigned v = 0;
-    int i = 0;
-    for (; i < 4; ++i) {
-      constexpr char b64[] =
-	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-      if (auto p = strchr(b64, text[i]); p) v = (v << 6) | unsigned(p - b64);
-      else break;
-    }
-    if (i < 4) {
-      if (i < 2 || text.size() > 4) throw -1;
-      for (auto t = i; t < 4; ++t) {
-	if (text[t] != '=') throw -1;
-	v <<= 6;
-      }
+  std::string decode(text.size() / 4 * 3, '\0');
+  auto out = decode.data();
+  auto p = reinterpret_cast<unsigned char const*>(text.data());
+  for (auto const end = p + text.size(); p != end; p += 4) {
+    // the value gets negative if any of the characters is not a digit.
+    auto const& b64 = digits.b64;
+    int v = b64[p[0]] << 18 | b64[p[1]] << 12 | b64[p[2]] << 6 | b64[p[3]];
+    if (v < 0) {
+      // only the last 4 characters may be padded.
+      auto n = b64[p[2]] < 0 ? 1 : 2;
+      if (p + 4 != end || (b64[p[0]] | b64[p[1]]) < 0 ||
+	  (n == 1 && p[2] != '=') || p[3] != '=') throw -1;
+      v = b64[p[0]] << 18 | b64[p[1]] << 12 | (n == 2 ? b64[p[2]] << 6 : 0);
+      *out++ = char(v >> 16);
+      if (n == 2) *out++ = char(v >> 8);
+      break;
     }
-    char const b[] { char(v >> 16), char(v >> 8), char(v) };
-    decode.append(b, i - 1);
-  };
+    out[0] = char(v >> 16), out[1] = char(v >> 8), out[2] = char(v);
+    out += 3;
+  }
+  decode.resize(out - decode.data());
   return decode;
 }
 
 std::string
 mail::decoder::decodeQ(std::string_view text)
 {
-  std::string decode;
-  while (!text.empty()) {
-    auto i = text.find_first_of("_=");
-    if (i) decode += text.substr(0, i);
-    if (i == text.npos) break;
-    auto c = ' ';
-    if (text[i++] == '=') {
-      if (i >= text.size() - 1) throw -1;
-      char const s[] { text[i], text[i + 1], 0 };
-      char* e;
-      c = char(strtoul(s, &e, 16));
-      if (e != s + 2) throw -1;
-      i += 2;
+  std::string decode(text.size(), '\0');
+  auto out = decode.data();
+  for (size_t i = 0; i < text.size(); ++i) {
+    auto c = text[i];
+    if (c == '_') {
+      c = ' ';
+    } else if (c == '=') {
+      if (i + 2 >= text.size()) throw -1;
+      int h = digits.hex[text[i + 1] & 255], l = digits.hex[text[i + 2] & 255];
+      if ((h | l) < 0) throw -1;
+      c = char(h << 4 | l), i += 2;
     }
-    decode += c;
-    text = text.substr(i);
+    *out++ = c;
   }
+  decode.resize(out - decode.data());
   return decode;
 }
 
@@ -320,7 +349,7 @@ mail::decoder::token(bool comment)
       i += i < _s.size();
     }
     _next = i != _s.npos ? i : _s.size();
-    if (comment || _s[s] != '(') return std::string_view(_s).substr(s, _next - s);
+    if (comment || _s[s] != '(') return _s.substr(s, _next - s);
   }
   return {};
 }
@@ -353,6 +382,19 @@ tokenizer::uppercase(std::string_view s)
   return u;
 }
 
+bool
+tokenizer::equal(std::string_view s, std::string_view upper) noexcept
+{
+  // compare the text with the uppercase word without converting.
+  if (s.size() != upper.size()) return false;
+  for (size_t i = 0; i < s.size(); ++i) {
+    auto c = s[i];
+    if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+    if (c != upper[i]) return false;
+  }
+  return true;
+}
+
 tokenizer::size_type
 tokenizer::findq(char const* s, size_type pos) const
 {
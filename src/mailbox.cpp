@@ -5,8 +5,10 @@
  * the license terms, see the LICENSE.txt file included with the program.
  */
 #include "stdafx.h"
+#include "inflate.h"
 
 #define TCP_TIMEOUT 60
+#define PROBE_TIMEOUT 5 // seconds to wait for the kept session.
 
 /** tcpstream - stream of TCP session.
  * This instance should be created by the function mailbox::backend::tcp.
@@ -15,13 +17,17 @@ namespace {
   class tcpstream : public mailbox::backend::stream {
     winsock::tcpclient _socket;
     int _verifylevel;
+    std::vector<char> _rbuf;
   public:
     tcpstream(int verifylevel) : _verifylevel(verifylevel) {}
     ~tcpstream() { _socket.shutdown(); }
     void connect(std::string const& host, std::string const& port, int domain);
     void disconnect() noexcept override { _socket.shutdown(); }
     size_t read(char* buf, size_t size) override;
+    std::string_view read() override;
     size_t write(char const* data, size_t size) override;
+    void timeout(int sec) override { _socket.timeout(sec); }
+    SOCKET handle() const noexcept override { return _socket.handle(); }
     bool tls() const noexcept override { return false; }
     mailbox::backend::stream* starttls(std::string const& host) override;
   };
@@ -40,6 +46,13 @@ tcpstream::read(char* buf, size_t size)
   return _socket.recv(buf, size);
 }
 
+std::string_view
+tcpstream::read()
+{
+  if (_rbuf.empty()) _rbuf.resize(16 * 1024);
+  return { _rbuf.data(), _socket.recv(_rbuf.data(), _rbuf.size()) };
+}
+
 size_t
 tcpstream::write(char const* data, size_t size)
 {
@@ -66,7 +79,11 @@ namespace {
     void connect(std::string const& host, std::string const& port, int domain);
     void disconnect() noexcept override { _tls.socket.shutdown(); }
     size_t read(char* buf, size_t size) override;
+    std::string_view read() override { return _tls.recv(); }
     size_t write(char const* data, size_t size) override;
+    void timeout(int sec) override { _tls.socket.timeout(sec); }
+    bool pending() const noexcept override { return _tls.pending(); }
+    SOCKET handle() const noexcept override { return _tls.socket.handle(); }
     bool tls() const noexcept override { return true; }
     mailbox::backend::stream* starttls(std::string const&) override { return {}; }
   };
@@ -75,7 +92,7 @@ namespace {
 void
 sslstream::_connect(std::string const& host)
 {
-  _tls.connect();
+  _tls.connect(host);
   if (_verifylevel) {
     DWORD ignore = 0;
     switch (_verifylevel) {
@@ -126,6 +143,86 @@ tcpstream::starttls(std::string const& host)
   return st.release();
 }
 
+/** zstream - stream compressed by DEFLATE (RFC 4978).
+ * This instance should be created by the function mailbox::backend::compress().
+ * The data sent is not compressed but put in stored blocks, because the
+ * commands are short enough.
+ */
+namespace {
+  class zstream : public mailbox::backend::stream {
+    std::unique_ptr<mailbox::backend::stream> _st;
+    inflater _inflater;
+    std::string _head;         // the compressed data received beforehand.
+    std::string_view _plain;   // the decompressed data not read yet.
+    std::string _sbuf;
+    unsigned long long _in[2] = {}, _out[2] = {}; // compressed and plain sizes.
+    mailbox::compression* _counter; // the sizes of the mailbox, if any.
+  public:
+    zstream(mailbox::backend::stream* st, std::string_view head, mailbox::compression* counter)
+      : _st(st), _head(head), _counter(counter) {}
+    ~zstream();
+    void disconnect() noexcept override { _st->disconnect(); }
+    size_t read(char* buf, size_t size) override;
+    std::string_view read() override;
+    size_t write(char const* data, size_t size) override;
+    void timeout(int sec) override { _st->timeout(sec); }
+    bool pending() const noexcept override { return !_plain.empty() || !_head.empty() || _st->pending(); }
+    SOCKET handle() const noexcept override { return _st->handle(); }
+    bool tls() const noexcept override { return _st->tls(); }
+    mailbox::backend::stream* starttls(std::string const&) override { return {}; }
+  };
+}
+
+zstream::~zstream()
+{
+  LOG("Compressed: received " << _in[0] << "/" << _in[1] <<
+      " bytes, sent " << _out[0] << "/" << _out[1] << " bytes." << std::endl);
+}
+
+std::string_view
+zstream::read()
+{
+  if (!_plain.empty()) return std::exchange(_plain, {});
+  try {
+    for (;;) {
+      auto data = !_head.empty() ? std::string_view(_head) : _st->read();
+      if (data.empty()) return {};
+      auto plain = _inflater.inflate(data);
+      _in[0] += data.size(), _in[1] += plain.size();
+      if (_counter) _counter->received[0] += data.size(), _counter->received[1] += plain.size();
+      _head.clear();
+      if (!plain.empty()) return plain;
+    }
+  } catch (inflater::error const& e) {
+    throw mailbox::error(e.what());
+  }
+}
+
+size_t
+zstream::read(char* buf, size_t size)
+{
+  if (_plain.empty()) _plain = read();
+  auto n = min(size, _plain.size());
+  CopyMemory(buf, _plain.data(), n);
+  _plain.remove_prefix(n);
+  return n;
+}
+
+size_t
+zstream::write(char const* data, size_t size)
+{
+  // a stored block is aligned to bytes, so it's flushed as is.
+  size = min(size, size_t(0xffff));
+  char const header[] = {
+    0, char(size), char(size >> 8), char(~size), char(~size >> 8),
+  };
+  _sbuf.assign(header, sizeof(header)).append(data, size);
+  for (std::string_view s(_sbuf); !s.empty();) s.remove_prefix(_st->write(s.data(), s.size()));
+  _out[0] += _sbuf.size(), _out[1] += size;
+  if (_counter) _counter->sent[0] += _sbuf.size(), _counter->sent[1] += size;
+  return size;
+}
+
 /*
  * Functions of the class mailbox::backend
  */
@@ -148,64 +245,152 @@ mailbox::backend::ssl(std::string const& host, std::string const& port, int doma
 void
 mailbox::backend::starttls(std::string const& host)
 {
+  flush();
   stream* st = _st->starttls(host);
-  if (st) _st.reset(st);
+  if (st) {
+    // discard the data received before TLS.
+    _st.reset(st), _span = {}, _rpos = _rend = 0;
+  }
 }
 
-std::string
-mailbox::backend::read(size_t size)
+void
+mailbox::backend::compress()
 {
-  std::string result;
-  if (auto n = min(_rbuf.size(), size); n) {
-    result.assign(_rbuf, 0, n);
-    _rbuf.erase(0, n);
-    size -= n;
-  }
-  while (size) {
-    char buf[1024];
-    auto n = _st->read(buf, min(size, sizeof(buf)));
-    result.append(buf, n);
-    size -= n;
+  flush();
+  // the data received after the response is compressed.
+  std::string head(_rbuf.data() + _rpos, _rend - _rpos);
+  head.append(_span);
+  _st.reset(new zstream(_st.release(), head, _compressed)), _span = {}, _rpos = _rend = 0;
+}
+
+void
+mailbox::backend::_keep()
+{
+  // move the received data into _rbuf to be joined with the following data.
+  if (_rpos == _rend) {
+    _rpos = _rend = 0;
+  } else if (_rend == _rbuf.size() && _rpos) {
+    MoveMemory(_rbuf.data(), _rbuf.data() + _rpos, _rend - _rpos);
+    _rend -= _rpos, _rpos = 0;
   }
-  return result;
+  if (_rend == _rbuf.size()) _rbuf.resize(max(_rbuf.size() * 2, size_t(4096)));
+  auto n = min(_span.size(), _rbuf.size() - _rend);
+  CopyMemory(_rbuf.data() + _rend, _span.data(), n);
+  _rend += n, _span.remove_prefix(n);
 }
 
-std::string
-mailbox::backend::read()
+void
+mailbox::backend::_more()
 {
+  while (!_span.empty()) _keep();
+  flush();
   try {
-    char buf[1024];
-    for (size_t i = 1;; _rbuf.append(buf, _st->read(buf, sizeof(buf)))) {
-      if (i >= _rbuf.size()) continue;
-      for (i = _rbuf.find('\012', i); i != _rbuf.npos; i = _rbuf.find('\012', i + 1)) {
-	if (_rbuf[i - 1] != '\015') continue;
-	std::string result(_rbuf, 0, i - 1);
-	_rbuf.erase(0, i + 1);
-	return result;
-      }
-      i = _rbuf.size();
-    }
+    _span = _st->read();
   } catch (winsock::timedout const&) {
-    if (_rbuf.empty()) throw silent();
+    if (_rpos == _rend) throw silent();
     throw;
   }
+  if (_span.empty()) throw error("disconnected");
+}
+
+bool
+mailbox::backend::_take(std::string_view& ln)
+{
+  for (size_t i = 0;; _keep()) {
+    if (_rpos == _rend) {
+      // take a line from the received data without copying.
+      if (auto n = _span.find("\015\012"); n != _span.npos) {
+	ln = _span.substr(0, n);
+	_span.remove_prefix(n + 2);
+	return true;
+      }
+      if (_span.empty()) return false;
+    }
+    auto const p = _rbuf.data() + _rpos;
+    auto const n = _rend - _rpos;
+    while (i < n) {
+      auto lf = static_cast<char const*>(memchr(p + i, '\012', n - i));
+      if (!lf) break;
+      i = lf - p + 1;
+      if (i > 1 && lf[-1] == '\015') {
+	_rpos += i;
+	ln = { p, i - 2 };
+	return true;
+      }
+    }
+    if (_span.empty()) return false;
+    i = n;
+  }
 }
 
 void
-mailbox::backend::write(char const* data, size_t size)
+mailbox::backend::read(char* buf, size_t size)
 {
-  while (size) {
-    size_t n = _st->write(data, size);
-    data += n, size -= n;
+  auto n = min(_rend - _rpos, size);
+  CopyMemory(buf, _rbuf.data() + _rpos, n);
+  _rpos += n, buf += n, size -= n;
+  n = min(_span.size(), size);
+  CopyMemory(buf, _span.data(), n);
+  _span.remove_prefix(n), buf += n, size -= n;
+  if (size) flush();
+  for (; size; buf += n, size -= n) {
+    n = _st->read(buf, size);
+    if (!n) throw error("disconnected");
   }
 }
 
+std::string
+mailbox::backend::read(size_t size)
+{
+  std::string result(size, '\0');
+  read(result.data(), size);
+  return result;
+}
+
+std::string_view
+mailbox::backend::readln()
+{
+  std::string_view ln;
+  while (!_take(ln)) _more();
+  return ln;
+}
+
+void
+mailbox::backend::write(char const* data, size_t size)
+{
+  // the data is buffered to be sent together until reading.
+  _wbuf.append(data, size);
+}
+
 void
 mailbox::backend::write(std::string const& data)
 {
-  std::string ln(data);
-  ln.append("\015\012");
-  write(ln.data(), ln.size());
+  _wbuf.append(data).append("\015\012");
+}
+
+void
+mailbox::backend::flush()
+{
+  std::string_view data(_wbuf);
+  while (!data.empty()) data.remove_prefix(_st->write(data.data(), data.size()));
+  _wbuf.clear();
+}
+
+/*
+ * Functions of the class maillist
+ */
+void
+maillist::push_back(mail const& m)
+{
+  _index.insert_or_assign(m.uid(), _mails.size());
+  _mails.push_back(m);
+}
+
+mail const*
+maillist::find(std::string const& uid) const
+{
+  auto p = _index.find(uid);
+  return p != _index.end() ? &_mails[p->second] : nullptr;
 }
 
 /*
@@ -219,33 +404,77 @@ mailbox::uripasswd(std::string const& uri, std::string const& passwd)
   return *this;
 }
 
-mail const*
-mailbox::find(std::string const& uid) const
+extern mailbox::backend* backendIMAP4();
+extern mailbox::backend* backendPOP3();
+
+static const struct {
+  char const* scheme;
+  mailbox::backend* (*make)();
+  void (mailbox::backend::*stream)(std::string const&, std::string const&, int, int);
+  char const* port;
+} backends[] = {
+  { "imap",     backendIMAP4, &mailbox::backend::tcp, "143" },
+  { "imap+ssl", backendIMAP4, &mailbox::backend::ssl, "993" },
+  { "pop",      backendPOP3,  &mailbox::backend::tcp, "110" },
+  { "pop+ssl",  backendPOP3,  &mailbox::backend::ssl, "995" },
+};
+
+void
+mailbox::prefetch() const
+{
+  // resolve the host beforehand.
+  for (auto const& b : backends) {
+    if (_uri[uri::scheme] != b.scheme) continue;
+    auto& port = _uri[uri::port];
+    winsock::prefetch(_uri[uri::host], port.empty() ? b.port : port, _domain);
+  }
+}
+
+std::pair<SOCKET, unsigned>
+mailbox::parked() const noexcept
+{
+  if (!_parked) return { INVALID_SOCKET, 0 };
+  return { _session->handle(), _parked };
+}
+
+void
+mailbox::_idling(std::unique_ptr<backend>& be, unsigned limit, bool wake)
 {
-  for (auto& t : _mails) {
-    if (t.uid() == uid) return &t;
+  // the session is parked without a thread, when it has nothing to read.
+  for (;; wake = true) {
+    if (auto left = wake ? be->wake() : limit; left) {
+      limit = left; // park for the rest of the idling.
+    } else {
+      try {
+	_recent = static_cast<int>(be->fetch(*this));
+      } catch (...) {
+	_recent = -1;
+	throw;
+      }
+      fetching(true);
+      limit = be->idle();
+    }
+    if (!be->pending()) break;
   }
-  return {};
+  _parked = limit, _session.swap(be);
 }
 
 void
 mailbox::fetchmail(bool idle)
 {
-  extern backend* backendIMAP4();
-  extern backend* backendPOP3();
-
-  static const struct {
-    char const* scheme;
-    backend* (*make)();
-    void (backend::*stream)(std::string const&, std::string const&, int, int);
-    char const* port;
-  } backends[] = {
-    { "imap",     backendIMAP4, &backend::tcp, "143" },
-    { "imap+ssl", backendIMAP4, &backend::ssl, "993" },
-    { "pop",      backendPOP3,  &backend::tcp, "110" },
-    { "pop+ssl",  backendPOP3,  &backend::ssl, "995" },
+  struct exhibit {
+    mailbox& mb;
+    exhibit(mailbox& mb, backend* be) : mb(mb) { mb.lock(), mb._backend = be; }
+    ~exhibit() { mb.lock(), mb._backend = {}; }
   };
-
+  std::unique_ptr<backend> be;
+  be.swap(_session);
+  if (auto limit = std::exchange(_parked, 0); limit) {
+    // resume the idling session.
+    exhibit exhibit { *this, be.get() };
+    fetching(false);
+    return _idling(be, limit, true);
+  }
   _recent = -1;
   int i = sizeof(backends) / sizeof(*backends);
   while (i-- && _uri[uri::scheme] != backends[i].scheme) continue;
@@ -258,24 +487,47 @@ mailbox::fetchmail(bool idle)
     u[uri::user] = "ANONYMOUS";
     if (pw.empty()) pw = "befoo@";
   }
-  std::unique_ptr<backend> be(backends[i].make());
-  ((*be).*backends[i].stream)(u[uri::host], u[uri::port], _domain, _verify);
-  struct exhibit {
-    mailbox& mb;
-    exhibit(mailbox& mb, backend* be) : mb(mb) { mb.lock(), mb._backend = be; }
-    ~exhibit() { mb.lock(), mb._backend = {}; }
-  } exhibit { *this, be.get() };
-  fetching(false);
-  idle = be->login(u, pw) && idle;
-  _recent = static_cast<int>(be->fetch(*this, u));
-  while (idle) {
-    fetching(idle);
+  auto resume = be && [&be] {
     try {
-      _recent = static_cast<int>(be->fetch(*this));
+      // a dead session should not keep the fetch waiting long.
+      be->timeout(PROBE_TIMEOUT);
+      auto alive = be->alive();
+      be->timeout(TCP_TIMEOUT);
+      return alive;
     } catch (...) {
-      _recent = -1;
-      throw;
+      return false;
     }
+  }();
+  if (!resume) {
+    be.reset(backends[i].make());
+    be->deflate(_compress, &_compressed);
+    ((*be).*backends[i].stream)(u[uri::host], u[uri::port], _domain, _verify);
+  }
+  ++(resume ? _resumed : _handshakes);
+  LOG("Session [" << _name << "]: " << _handshakes << " handshakes, " <<
+      _resumed << " avoided." << std::endl);
+  exhibit exhibit { *this, be.get() };
+  fetching(false);
+  if (!resume) _idlable = be->login(u, pw);
+  idle = idle && _idlable;
+  _recent = static_cast<int>(be->fetch(*this, u));
+  if (idle) {
+    fetching(idle);
+    return _idling(be, be->idle(), false);
   }
-  be->logout();
+  if (be->persistent()) _session.swap(be);
+  else be->logout();
+}
+
+void
+mailbox::logout() noexcept
+{
+  // log out the session kept or parked, without waiting long.
+  std::unique_ptr<backend> be;
+  be.swap(_session), _parked = 0;
+  if (!be) return;
+  try {
+    be->timeout(PROBE_TIMEOUT);
+    be->logout();
+  } catch (...) {}
 }
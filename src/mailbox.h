@@ -11,16 +11,19 @@
 #include <list>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
 #include <functional>
 #include <mutex>
 
+// tokenizer - base of the parsers over a text, which must live while parsing.
 class tokenizer {
 protected:
-  std::string _s;
+  std::string_view _s;
   using size_type = decltype(_s)::size_type;
   size_type _next = 0;
-  auto uppercase(size_type to) const
-  { return uppercase(std::string_view(_s).substr(_next, to - _next)); }
   auto findf(char const* s) const { return _s.find_first_of(s, _next); }
   auto findf(char const* s, size_type pos) const
   { return _s.find_first_of(s, pos); }
@@ -28,15 +31,15 @@ protected:
   size_type findq(char const* s, size_type pos) const;
 public:
   tokenizer() {}
-  tokenizer(std::string const& s) : _s(s) {}
+  tokenizer(std::string_view s) : _s(s) {}
   explicit operator bool() const noexcept { return _next < _s.size(); }
-  auto& data() const noexcept { return _s; }
-  auto remain() const noexcept
-  { return std::string_view(_s).substr(std::min<size_type>(_next, _s.size())); }
+  auto data() const noexcept { return _s; }
+  auto remain() const noexcept { return _s.substr(std::min<size_type>(_next, _s.size())); }
   int peek() const { return _next < _s.size() ? _s[_next] & 255 : -1; }
 
   static bool digit(std::string_view s, int* value = {}) noexcept;
   static std::string uppercase(std::string_view s);
+  static bool equal(std::string_view s, std::string_view upper) noexcept;
 };
 
 class mail {
@@ -56,6 +59,7 @@ public:
 public:
   // decoder - parse and decode a message.
   class decoder : public tokenizer {
+    std::string _unfolded; // the last field value unfolded.
   protected:
     static std::string_view trim(std::string_view text);
     std::string eword(std::string::size_type to);
@@ -65,15 +69,65 @@ public:
     static std::string decodeQ(std::string_view text);
     std::string_view token(bool comment = false);
   public:
+    // fieldset - header field names matched without case.
+    // The names are placed in a table by a hash of the length and the
+    // first and last letters, which is searched for no collision when
+    // the set is built at compile time. So a name found in the table is
+    // the only candidate to be compared.
+    class fieldset {
+      static constexpr unsigned _size = 32;
+      std::string_view _names[_size];
+      int _index[_size];
+      unsigned _seed = 1;
+      constexpr unsigned _hash(std::string_view s) const noexcept {
+	return (unsigned(s.size()) + (s.front() | 0x20) * _seed + (s.back() | 0x20)) % _size;
+      }
+    public:
+      // the names must be uppercase.
+      constexpr fieldset(std::initializer_list<std::string_view> names) : _names(), _index() {
+	for (;; ++_seed) {
+	  if (_seed > 256) throw "no perfect hash";
+	  for (auto& i : _index) i = -1;
+	  auto n = 0;
+	  for (auto name : names) {
+	    auto h = _hash(name);
+	    if (_index[h] >= 0) break;
+	    _names[h] = name, _index[h] = n++;
+	  }
+	  if (n == int(names.size())) break;
+	}
+      }
+      int operator()(std::string_view name) const noexcept {
+	if (name.empty()) return -1;
+	auto h = _hash(name);
+	return _index[h] >= 0 && equal(name, _names[h]) ? _index[h] : -1;
+      }
+    };
     decoder() {}
-    decoder(std::string const& s) : tokenizer(s) {}
-    std::pair<int, std::string> field(std::initializer_list<char const*> names);
+    decoder(std::string_view s) : tokenizer(s) {}
+    std::pair<int, std::string_view> field(fieldset const& names);
     std::string unstructured() { return eword(_s.size()); }
     std::pair<std::string, std::string> address();
     time_t date();
   };
 };
 
+// maillist - mails in the received order, indexed by UID.
+class maillist {
+  std::vector<mail> _mails;
+  std::unordered_map<std::string, size_t> _index;
+public:
+  auto begin() const noexcept { return _mails.cbegin(); }
+  auto end() const noexcept { return _mails.cend(); }
+  auto crbegin() const noexcept { return _mails.crbegin(); }
+  auto crend() const noexcept { return _mails.crend(); }
+  auto size() const noexcept { return _mails.size(); }
+  auto empty() const noexcept { return _mails.empty(); }
+  void swap(maillist& mails) noexcept { _mails.swap(mails._mails), _index.swap(mails._index); }
+  void push_back(mail const& m);
+  mail const* find(std::string const& uid) const;
+};
+
 class uri {
   std::string _part[6];
 public:
@@ -92,10 +146,12 @@ class mailbox {
   std::string _passwd;
   int _domain = 0;
   int _verify = 0;
+  bool _compress = true;
   std::mutex mutable _mutex;
-  std::list<mail> _mails;
+  maillist _mails;
   int _recent = 0;
-  std::list<std::string> _ignore;
+  std::unordered_set<std::string> _ignore;
+  std::pair<unsigned long, unsigned long long> _modseq; // UIDVALIDITY and HIGHESTMODSEQ.
 public:
   mailbox(std::string const& name = {}) : _name(name) {}
   virtual ~mailbox() {}
@@ -107,50 +163,97 @@ public:
   mailbox& uripasswd(std::string const& uri, std::string const& passwd);
   mailbox& domain(int domain) noexcept { return _domain = domain, *this; }
   mailbox& verify(int verify) noexcept { return _verify = verify, *this; }
+  mailbox& compress(bool compress) noexcept { return _compress = compress, *this; }
+  auto& compressed() const noexcept { return _compressed; }
   auto lock() const { return std::unique_lock(_mutex); }
   auto& mails() const noexcept { return _mails; }
-  auto const& mails(std::list<mail>& mails) { return _mails.swap(mails), _mails; }
+  auto const& mails(maillist& mails) { return _mails.swap(mails), _mails; }
   auto recent() const noexcept { return _recent; }
-  mail const* find(std::string const& uid) const;
+  auto find(std::string const& uid) const { return _mails.find(uid); }
+  auto& modseq() const noexcept { return _modseq; }
+  mailbox& modseq(unsigned long validity, unsigned long long modseq) noexcept
+  { return _modseq = { validity, modseq }, *this; }
   auto& ignore() const noexcept { return _ignore; }
-  auto const& ignore(std::list<std::string>& ignore)
+  auto const& ignore(std::unordered_set<std::string>& ignore)
   { return _ignore.swap(ignore), _ignore; }
+  void prefetch() const;
   void fetchmail(bool idle = false);
   void exit() noexcept { if (_backend) _backend->disconnect(); }
+  std::pair<SOCKET, unsigned> parked() const noexcept;
+  void unpark() noexcept { if (_parked) _parked = 0, _session.reset(); }
+  void keep() noexcept { _parked = 0; } // resume the parked session by the next fetch.
+  void logout() noexcept;
 public:
+  // compression - the sizes of the data by COMPRESS=DEFLATE.
+  struct compression {
+    unsigned long long received[2] = {}; // compressed and plain sizes.
+    unsigned long long sent[2] = {};
+  };
   class backend {
     class _stream {
     public:
       virtual ~_stream() {}
       virtual void disconnect() noexcept = 0;
       virtual size_t read(char* buf, size_t size) = 0;
+      virtual std::string_view read() = 0; // valid until the next read.
       virtual size_t write(char const* data, size_t size) = 0;
+      virtual void timeout(int sec) = 0;
+      virtual bool pending() const noexcept { return false; }
+      virtual SOCKET handle() const noexcept = 0;
       virtual bool tls() const noexcept = 0;
       virtual _stream* starttls(std::string const& host) = 0;
     };
     std::unique_ptr<_stream> _st;
-    std::string _rbuf;
+    std::vector<char> _rbuf;
+    size_t _rpos = 0, _rend = 0; // the unread range of _rbuf.
+    std::string_view _span;      // the unread data in the stream.
+    std::string _wbuf;           // the data not written yet.
+    bool _deflate = true;        // COMPRESS=DEFLATE may be used.
+    compression* _compressed = {}; // the sizes to be counted.
+    void _keep();
+    void _more();
+    bool _take(std::string_view& ln);
   protected:
     auto tls() const noexcept { return _st->tls(); }
+    auto deflate() const noexcept { return _deflate; }
     void starttls(std::string const& host);
+    void compress();
+    void read(char* buf, size_t size);
     std::string read(size_t size);
-    std::string read();
+    std::string_view readln(); // valid until the next read.
+    std::string read() { return std::string(readln()); }
     void write(char const* data, size_t size);
     void write(std::string const& data);
+    void flush();
   public:
     using stream = _stream;
     virtual ~backend() {}
+    void deflate(bool deflate, compression* counter = {}) noexcept { _deflate = deflate, _compressed = counter; }
     void tcp(std::string const& host, std::string const& port, int domain, int verify);
     void ssl(std::string const& host, std::string const& port, int domain, int verify);
     void disconnect() noexcept { if (_st.get()) _st->disconnect(); }
+    SOCKET handle() const noexcept { return _st->handle(); }
+    void timeout(int sec) { _st->timeout(sec); }
+    virtual bool pending() const noexcept { return _rpos < _rend || !_span.empty() || _st->pending(); }
     virtual bool login(uri const& uri, std::string const& passwd) = 0;
     virtual void logout() = 0;
     virtual size_t fetch(mailbox& mbox, uri const& uri) = 0;
     virtual size_t fetch(mailbox&) { return 0; }
+    virtual bool persistent() const noexcept { return false; }
+    virtual bool alive() { return false; }
+    virtual unsigned idle() { return 0; } // seconds to wait for the events.
+    virtual unsigned wake() { return 0; } // seconds left, or 0 if the idling was finished.
   };
   virtual void fetching(bool idle) = 0;
 private:
   backend* _backend = {};
+  compression _compressed;           // the sizes of all the sessions, which outlive them.
+  std::unique_ptr<backend> _session; // the session kept for the next fetch.
+  unsigned _parked = 0;              // seconds to wait for the idling session.
+  bool _idlable = false;             // the session supports idling.
+  void _idling(std::unique_ptr<backend>& be, unsigned limit, bool wake);
+  unsigned _handshakes = 0;
+  unsigned _resumed = 0;
 public:
   class error : public std::exception {
     std::string _msg;
@@ -5,6 +5,8 @@
  * the license terms, see the LICENSE.txt file included with the program.
  */
 #include "stdafx.h"
+#include "executor.h"
+#include "poller.h"
 #include <thread>
 #include <mutex>
 #include <imagehlp.h>
@@ -21,22 +23,23 @@ namespace {
       enum { STOP, RUN, EXIT } _state = STOP;
       bool _idle = false;
       bool _idling = false;
-      void _fetch();
       void _fetched(bool idle = false);
       void fetching(bool idle) override;
     public:
       mbox(std::string const& name, model& model) : mailbox(name), _model(model) {}
-      ~mbox() { exit(); }
+      ~mbox() { exit(), logout(); }
     public:
       unsigned period = 0;
       unsigned cycle = 0;
       unsigned remain = 0;
       std::string sound;
+      setting::uidcache cache;
     public:
       auto next() noexcept { return static_cast<mbox*>(mailbox::next()); }
       auto ready() const noexcept { return _state == STOP; }
       auto& idle(bool idle) noexcept { return _idle = idle, *this; }
       void fetch();
+      void run() noexcept;
       void exit() noexcept;
     };
     mbox* _mailboxes = {};
@@ -55,34 +58,42 @@ namespace {
     DWORD _last = GetTickCount();
     unsigned _fetching = 0;
     std::vector<mailbox*> _fetch;
+    executor<mbox> _executor; // run fetching mailboxes.
+    poller _poller; // IDLE sessions waiting for the events.
     int _summary = 0;
     void _done(mbox& mb, bool fetched, bool idling);
   };
 }
 
 void
-model::mbox::_fetch()
+model::mbox::run() noexcept
 {
-  {
-    auto lock = mailbox::lock();
-    _state = RUN;
-    _cond.notify_all();
-  }
   LOG("Start thread [" << name() << "]." << std::endl);
   try {
     fetchmail(_idle);
+    if (auto [socket, limit] = parked(); limit) {
+      if (auto lock = mailbox::lock(); _state != EXIT) {
+	// the session waits for the events without the thread.
+	_model._poller.wait(this, socket, limit * 1000ULL,
+			    [this](bool) { _model._executor.dispatch(this); });
+	LOG("Park thread [" << name() << "]." << std::endl);
+	return;
+      }
+    }
   } catch (std::exception const& DBG(e)) {
     LOG(e.what() << std::endl);
   } catch (...) {
     LOG("Unknown exception." << std::endl);
   }
   LOG("End thread [" << name() << "]." << std::endl);
+  unpark();
   _fetched();
 }
 
 void
 model::mbox::_fetched(bool idle)
 {
+  try { cache.update(ignore()); } catch (...) {}
   std::swap(idle, _idling);
   auto gen = _state != EXIT;
   if (gen) {
@@ -111,9 +122,11 @@ model::mbox::fetching(bool idle)
 void
 model::mbox::fetch()
 {
-  auto lock = mailbox::lock();
-  std::thread([this] { _fetch(); }).detach();
-  _cond.wait(lock, [this] { return _state != STOP; });
+  {
+    auto lock = mailbox::lock();
+    _state = RUN;
+  }
+  _model._executor.dispatch(this);
 }
 
 void
@@ -121,6 +134,15 @@ model::mbox::exit() noexcept
 {
   auto lock = mailbox::lock();
   if (_state == STOP) return;
+  // the poller is canceled first, because its function dispatches the
+  // session to the executor. It has returned if it was called.
+  if (_model._poller.cancel(this) == poller::CANCELED || _model._executor.cancel(this)) {
+    // the session might be idling without the thread, which is kept
+    // to be resumed or logged out.
+    keep();
+    _state = STOP, _idling = false;
+    return;
+  }
   _state = EXIT;
   mailbox::exit();
   _cond.wait(lock, [this] { return _state == STOP; });
@@ -130,27 +152,41 @@ model::model()
 {
   try {
     mailbox* last = {};
+    std::unordered_set<std::string> kept; // caches kept in the settings.
     for (auto& name : setting::mailboxes()) {
       LOG("Load mailbox [" << name << "]" << std::endl);
       std::unique_ptr<mbox> mb(new mbox(name, *this));
       auto s = setting::mailbox(name);
-      int ip, verify;
+      int ip, verify, compress;
       s["ip"](ip = 0);
       s["verify"](verify = 3);
+      s["compress"](compress = 1);
       mb->uripasswd(s["uri"], s.cipher("passwd"))
 	.domain(ip == 4 ? AF_INET : ip == 6 ? AF_INET6 : AF_UNSPEC)
-	.verify(verify);
+	.verify(verify)
+	.compress(compress != 0);
       int period, idle;
       s["period"](period = 15)(idle = 1);
       s["sound"].sep(0)(mb->sound);
       mb->cycle = mb->period = period > 0 ? period * 60000U : 0;
       mb->idle(idle != 0);
-      auto ignore = setting::cache(mb->uristr());
+      mb->cache = setting::uidcache(name, mb->uristr());
+      std::unordered_set<std::string> ignore;
+      if (!mb->cache.load(ignore)) { // migrate the cache from the settings.
+	auto cache = setting::cache(mb->uristr());
+	ignore.insert(cache.cbegin(), cache.cend());
+	try { mb->cache.update(ignore); } catch (...) {}
+	if (!mb->cache) kept.insert(mb->uristr());
+      }
       mb->ignore(ignore);
       last = last ? last->next(mb.release()) : (_mailboxes = mb.release());
     }
-    setting::cacheclear();
+    setting::cacheclear(kept);
+    for (auto p = _mailboxes; p; p = p->next()) p->prefetch();
     setting::preferences()["summary"]()(_summary);
+    int threads;
+    setting::preferences()["threads"](threads = 8);
+    _executor.limit(threads);
   } catch (...) {
     _release();
     throw;
@@ -177,7 +213,14 @@ model::exit(bool cache) noexcept
   _fetching = 0, _fetch.clear();
   if (!cache) return;
   for (auto p = _mailboxes; p; p = p->next()) {
-    try { setting::cache(p->uristr(), p->ignore()); } catch (...) {}
+    try {
+      if (p->cache) {
+	p->cache.compact();
+      } else {
+	auto& ignore = p->ignore();
+	setting::cache(p->uristr(), std::list<std::string>(ignore.cbegin(), ignore.cend()));
+      }
+    } catch (...) {}
   }
 }
 
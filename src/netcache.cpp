@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#include "netcache.h"
+
+/*
+ * Functions of the class verifycache
+ */
+std::string
+verifycache::_key(std::string const& host, unsigned long ignore)
+{
+  return host + '/' + std::to_string(ignore);
+}
+
+/*
+ * Functions of the class handshakes
+ */
+void
+handshakes::add(bool resumed, unsigned long long ms)
+{
+  std::lock_guard lock(_mutex);
+  if (resumed) ++_stats.resumed, _stats.resumedms += ms;
+  else ++_stats.full, _stats.fullms += ms;
+}
+
+handshakes::statistics
+handshakes::get()
+{
+  std::lock_guard lock(_mutex);
+  return _stats;
+}
+
+/*
+ * Functions of the class eyeballs
+ */
+void
+eyeballs::connected(std::string const& host, int family)
+{
+  if (host.empty()) return;
+  std::lock_guard lock(_mutex);
+  _families[host] = family;
+}
+
+// wait - ms to wait for the pending attempts before the next one, or 0
+// when they are timed out.
+unsigned long long
+eyeballs::wait(bool more, unsigned long long elapse) noexcept
+{
+  if (elapse >= timeout) return 0;
+  auto rest = timeout - elapse;
+  return more && rest > delay ? delay : rest;
+}
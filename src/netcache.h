@@ -0,0 +1,230 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#pragma once
+
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/** resolvecache - resolved addresses shared by the process.
+ * The entry in progress is shared by the concurrent resolutions and the
+ * prefetching, so the same addresses are resolved only once. The errors
+ * are kept for the shorter time than the addresses.
+ */
+template<class T>
+class resolvecache {
+public:
+  using lookup_type = std::function<T(std::string const& host, std::string const& port, int domain)>;
+  using clock_type = std::function<unsigned long long()>; // ms
+private:
+  struct _entry {
+    std::shared_future<T> value;
+    unsigned long long expire;
+  };
+  lookup_type _lookup;
+  clock_type _clock;
+  unsigned long long _ttl, _negttl;
+  std::mutex _mutex;
+  std::unordered_map<std::string, _entry> _entries;
+  std::vector<std::thread> _prefetching; // joined before the cleanup.
+  bool _valid(_entry const& e) const { return e.value.valid() && e.expire > _clock(); }
+  void _resolve(std::string const& key, std::string const& host, std::string const& port, int domain,
+		std::promise<T>& promise) noexcept;
+  static std::string _key(std::string const& host, std::string const& port, int domain)
+  { return host + ':' + port + '/' + std::to_string(domain); }
+public:
+  resolvecache(lookup_type lookup, clock_type clock, unsigned long long ttl, unsigned long long negttl)
+    : _lookup(lookup), _clock(clock), _ttl(ttl), _negttl(negttl) {}
+  ~resolvecache() { join(); }
+  T resolve(std::string const& host, std::string const& port, int domain);
+  bool prefetch(std::string const& host, std::string const& port, int domain);
+  void forget(std::string const& host, std::string const& port, int domain);
+  void join();
+};
+
+/** verifycache - fingerprints of the verified certificates.
+ * The certificate of the same fingerprint is trusted without checking
+ * the chain again until the TTL expires. The entries are kept for each
+ * host and level of the ignored errors.
+ */
+class verifycache {
+public:
+  using clock_type = std::function<unsigned long long()>; // ms
+private:
+  struct _entry {
+    std::string fingerprint;
+    unsigned long long expire;
+  };
+  clock_type _clock;
+  unsigned long long _ttl;
+  std::mutex _mutex;
+  std::unordered_map<std::string, _entry> _entries;
+  static std::string _key(std::string const& host, unsigned long ignore);
+public:
+  verifycache(clock_type clock, unsigned long long ttl) : _clock(clock), _ttl(ttl) {}
+  template<class F> bool verify(std::string const& host, unsigned long ignore,
+				std::string const& fingerprint, F check);
+};
+
+/** handshakes - counts and elapsed times of the TLS handshakes.
+ */
+class handshakes {
+public:
+  struct statistics {
+    unsigned full = 0, resumed = 0;
+    unsigned long long fullms = 0, resumedms = 0;
+  };
+private:
+  std::mutex _mutex;
+  statistics _stats;
+public:
+  void add(bool resumed, unsigned long long ms);
+  statistics get();
+};
+
+/** eyeballs - order and pacing of the connection attempts (RFC 8305).
+ * The address families are interleaved, and the family connected lastly
+ * to the host goes first. The attempts are started one by one with the
+ * delay, and the pending ones are given up at the timeout.
+ */
+class eyeballs {
+  std::mutex _mutex;
+  std::unordered_map<std::string, int> _families; // connected lastly for each host.
+public:
+  static constexpr unsigned delay = 250;     // ms between the attempts.
+  static constexpr unsigned timeout = 30000; // ms
+  template<class A> std::vector<A const*> order(A const* ai, std::string const& host = {});
+  void connected(std::string const& host, int family);
+  static unsigned long long wait(bool more, unsigned long long elapse) noexcept;
+};
+
+/*
+ * Functions of the class resolvecache
+ */
+template<class T> void
+resolvecache<T>::_resolve(std::string const& key, std::string const& host, std::string const& port,
+			  int domain, std::promise<T>& promise) noexcept
+{
+  auto ttl = _negttl;
+  try {
+    promise.set_value(_lookup(host, port, domain));
+    ttl = _ttl;
+  } catch (...) {
+    promise.set_exception(std::current_exception());
+  }
+  std::lock_guard lock(_mutex);
+  if (auto p = _entries.find(key); p != _entries.end()) p->second.expire = _clock() + ttl;
+}
+
+template<class T> T
+resolvecache<T>::resolve(std::string const& host, std::string const& port, int domain)
+{
+  auto key = _key(host, port, domain);
+  std::promise<T> promise;
+  std::shared_future<T> result;
+  auto cached = false;
+  {
+    std::lock_guard lock(_mutex);
+    auto& entry = _entries[key];
+    cached = _valid(entry);
+    if (cached) result = entry.value;
+    else entry = { result = promise.get_future().share(), ~0ULL }; // in progress.
+  }
+  if (!cached) _resolve(key, host, port, domain, promise);
+  return result.get(); // wait for the other resolution if any.
+}
+
+template<class T> bool
+resolvecache<T>::prefetch(std::string const& host, std::string const& port, int domain)
+{
+  // the entry in progress is made before the thread starts.
+  auto key = _key(host, port, domain);
+  std::promise<T> promise;
+  std::lock_guard lock(_mutex);
+  auto& entry = _entries[key];
+  if (_valid(entry)) return false;
+  entry = { promise.get_future().share(), ~0ULL };
+  try {
+    _prefetching.emplace_back([=, this, promise = std::move(promise)]() mutable {
+      _resolve(key, host, port, domain, promise);
+    });
+  } catch (...) {
+    _entries.erase(key); // resolved later on demand.
+    return false;
+  }
+  return true;
+}
+
+template<class T> void
+resolvecache<T>::forget(std::string const& host, std::string const& port, int domain)
+{
+  std::lock_guard lock(_mutex);
+  _entries.erase(_key(host, port, domain));
+}
+
+template<class T> void
+resolvecache<T>::join()
+{
+  decltype(_prefetching) threads;
+  {
+    std::lock_guard lock(_mutex);
+    threads.swap(_prefetching);
+  }
+  for (auto& t : threads) t.join();
+}
+
+/*
+ * Functions of the class verifycache
+ * check() checks the chain of the certificate, which is skipped when
+ * the fingerprint is cached. The empty fingerprint is never cached.
+ */
+template<class F> bool
+verifycache::verify(std::string const& host, unsigned long ignore,
+		    std::string const& fingerprint, F check)
+{
+  auto key = _key(host, ignore);
+  if (!fingerprint.empty()) {
+    std::lock_guard lock(_mutex);
+    if (auto p = _entries.find(key); p != _entries.end()) {
+      if (p->second.fingerprint == fingerprint && p->second.expire > _clock()) return true;
+      _entries.erase(p); // changed or expired.
+    }
+  }
+  if (!check()) return false;
+  if (!fingerprint.empty()) {
+    std::lock_guard lock(_mutex);
+    _entries[key] = { fingerprint, _clock() + _ttl };
+  }
+  return true;
+}
+
+/*
+ * Functions of the class eyeballs
+ * A is addrinfo, or the structure which has ai_family and ai_next.
+ */
+template<class A> std::vector<A const*>
+eyeballs::order(A const* ai, std::string const& host)
+{
+  std::vector<A const*> addrs;
+  if (!ai) return addrs;
+  auto family = ai->ai_family;
+  if (!host.empty()) {
+    std::lock_guard lock(_mutex);
+    if (auto p = _families.find(host); p != _families.end()) family = p->second;
+  }
+  std::vector<A const*> first, second;
+  for (auto p = ai; p; p = p->ai_next) (p->ai_family == family ? first : second).push_back(p);
+  for (size_t i = 0; i < first.size() || i < second.size(); ++i) {
+    if (i < first.size()) addrs.push_back(first[i]);
+    if (i < second.size()) addrs.push_back(second[i]);
+  }
+  return addrs;
+}
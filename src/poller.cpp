@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#include "stdafx.h"
+#include "poller.h"
+#include <chrono>
+#include <climits>
+#include <thread>
+#include <tuple>
+#if !_WIN32
+// the sockets of POSIX for the tests.
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define SOCKET_ERROR (-1)
+#define WSAPoll poll
+#define closesocket close
+#define ioctlsocket ioctl
+typedef pollfd WSAPOLLFD;
+typedef socklen_t socklen;
+typedef int nonblocking;
+#else
+typedef int socklen;
+typedef u_long nonblocking;
+#endif
+
+namespace {
+  unsigned long long
+  now() noexcept
+  {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+  }
+
+  WSAPOLLFD
+  pollin(SOCKET socket) noexcept
+  {
+    WSAPOLLFD fd {};
+    fd.fd = decltype(fd.fd)(socket), fd.events = POLLRDNORM;
+    return fd;
+  }
+}
+
+/*
+ * Functions of the class poller
+ */
+poller::~poller()
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  _exit = true;
+  _wakeup();
+  _cond.wait(lock, [this] { return !_running; });
+  if (_signal != INVALID_SOCKET) closesocket(_signal);
+}
+
+void
+poller::_wakeup() noexcept
+{
+  char const c = 0;
+  if (_running) ::send(_signal, &c, 1, 0);
+}
+
+void
+poller::_loop() noexcept
+{
+  std::vector<WSAPOLLFD> fds;
+  std::vector<void const*> keys;
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (!_exit) {
+    fds.assign(1, pollin(_signal));
+    keys.assign(1, nullptr);
+    auto t = now();
+    auto wait = ~0ULL;
+    for (auto const& [key, e] : _entries) {
+      fds.push_back(pollin(e.socket)), keys.push_back(key);
+      wait = min(wait, e.expire > t ? e.expire - t : 0);
+    }
+    lock.unlock();
+    auto n = WSAPoll(fds.data(), unsigned(fds.size()), wait != ~0ULL ? int(min(wait, 0ULL + INT_MAX)) : -1);
+    if (n > 0 && fds[0].revents) {
+      for (char c[32]; ::recv(_signal, c, sizeof(c), 0) > 0;) continue;
+    }
+    lock.lock();
+    std::vector<std::tuple<void const*, std::function<void(bool)>, bool>> fired;
+    t = now();
+    for (size_t i = 1; i < fds.size(); ++i) {
+      auto p = _entries.find(keys[i]);
+      if (p == _entries.end() || fds[i].fd != pollin(p->second.socket).fd) continue;
+      // a failure of polling is reported as readable to be detected by reading.
+      auto ready = n == SOCKET_ERROR || (n > 0 && fds[i].revents);
+      if (!ready && p->second.expire > t) continue;
+      fired.emplace_back(keys[i], std::move(p->second.fn), ready);
+      _fired[keys[i]] = true; // cancel() waits for the function.
+      _entries.erase(p);
+    }
+    if (fired.empty()) continue;
+    lock.unlock();
+    for (auto& [key, fn, ready] : fired) {
+      try {
+	fn(ready);
+      } catch (...) {
+	LOG("Failed to call the poller function." << std::endl);
+      }
+    }
+    lock.lock();
+    for (auto const& f : fired) {
+      if (auto p = _fired.find(std::get<0>(f)); p != _fired.end()) p->second = false;
+    }
+    _cond.notify_all();
+  }
+  _running = false;
+  _cond.notify_all();
+}
+
+void
+poller::wait(void const* key, SOCKET socket, unsigned long long ms, std::function<void(bool)> fn)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (_signal == INVALID_SOCKET) {
+    // a loopback UDP socket connected to itself.
+    SOCKET s = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    sockaddr_in sin {};
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    auto sa = reinterpret_cast<sockaddr*>(&sin);
+    socklen len = sizeof(sin);
+    nonblocking nb = 1;
+    if (s == INVALID_SOCKET ||
+	bind(s, sa, len) == SOCKET_ERROR ||
+	getsockname(s, sa, &len) == SOCKET_ERROR ||
+	::connect(s, sa, len) == SOCKET_ERROR ||
+	ioctlsocket(s, FIONBIO, &nb) == SOCKET_ERROR) {
+      winsock::error e;
+      if (s != INVALID_SOCKET) closesocket(s);
+      throw e;
+    }
+    _signal = s;
+  }
+  _fired.erase(key);
+  _entries.insert_or_assign(key, _entry { socket, now() + ms, std::move(fn) });
+  if (!_running) {
+    std::thread([this] { _loop(); }).detach();
+    _running = true;
+  } else {
+    _wakeup();
+  }
+}
+
+poller::status
+poller::cancel(void const* key)
+{
+  std::unique_lock<std::mutex> lock(_mutex);
+  if (_entries.erase(key)) {
+    _wakeup();
+    return CANCELED;
+  }
+  if (!_fired.contains(key)) return NONE;
+  _cond.wait(lock, [this, key] { // while the function is being called.
+    auto p = _fired.find(key);
+    return p == _fired.end() || !p->second;
+  });
+  _fired.erase(key);
+  return DISPATCHED;
+}
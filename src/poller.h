@@ -0,0 +1,46 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+/** poller - waiting for sockets to be readable.
+ * A thread polls all the waiting sockets, and calls the function
+ * once when the socket becomes readable or the time is expired.
+ * The function must not call cancel(), which waits for it.
+ */
+class poller {
+  struct _entry {
+    SOCKET socket;
+    unsigned long long expire;
+    std::function<void(bool)> fn; // called with true if readable.
+  };
+  std::unordered_map<void const*, _entry> _entries;
+  std::unordered_map<void const*, bool> _fired; // true while the function is called.
+  SOCKET _signal = INVALID_SOCKET; // to wake the thread up.
+  bool _running = false;
+  bool _exit = false;
+  std::mutex _mutex;
+  std::condition_variable _cond;
+  void _wakeup() noexcept;
+  void _loop() noexcept;
+public:
+  enum status {
+    NONE,       // the key isn't waiting.
+    CANCELED,   // the function will never be called.
+    DISPATCHED, // the function has been called.
+  };
+  poller() {}
+  ~poller();
+  poller(poller const&) = delete;
+  void operator=(poller const&) = delete;
+  void wait(void const* key, SOCKET socket, unsigned long long ms, std::function<void(bool)> fn);
+  status cancel(void const* key);
+};
@@ -10,9 +10,13 @@
  * This class is a mailbox::backend for POP3 protocol.
  */
 class pop3 : public mailbox::backend {
+  bool _pipelining = false;
+  void _send(std::vector<std::string> const& cmds);
   bool _command(std::string const& cmd, bool ok = true);
   bool _ok(bool ok = true);
   using plist = std::list<std::pair<std::string, std::string>>;
+  using pfunc = std::function<void(std::string_view, std::string_view)>;
+  void _plist(pfunc const& f, bool upper = false);
   plist _plist(bool upper = false);
   std::string _headers();
 #ifdef _DEBUG
@@ -50,11 +54,17 @@ pop3::login(uri const& uri, std::string const& passwd)
     auto user = false;
     for (auto const& [tag, param] : capa) {
       user = user || tag == "USER";
+      _pipelining = _pipelining || tag == "PIPELINING";
     }
     if (!user) throw mailbox::error("login disabled");
   }
-  _command("USER " + uri[uri::user]);
-  _command("PASS " + passwd);
+  if (_pipelining) {
+    _send({ "USER " + uri[uri::user], "PASS " + passwd });
+    _ok(), _ok();
+  } else {
+    _command("USER " + uri[uri::user]);
+    _command("PASS " + passwd);
+  }
   return false;
 }
 
@@ -68,38 +78,57 @@ size_t
 pop3::fetch(mailbox& mbox, uri const& uri)
 {
   auto& ignore = mbox.ignore();
-  std::list<std::string> ignored;
-  std::list<mail> mails, recents;
+  std::unordered_set<std::string> ignored;
+  maillist mails;
+  std::list<mail> recents;
+  std::list<std::pair<std::string, std::string>> news;
   auto recent = uri[uri::fragment] == "recent";
   _command("UIDL");
-  plist uidl(_plist());
-  for (auto const& [msg, uid] : uidl) {
-    if (auto e = ignore.cend(); find(ignore.cbegin(), e, uid) != e) {
-      ignored.push_back(uid);
-      continue;
-    }
-    LOG("Fetch mail: " << uid << std::endl);
-    _command("TOP " + msg + " 0");
-    mail m(uid);
-    if (m.header(_headers())) {
-      ignored.push_back(uid);
-      continue;
+  _plist([&](std::string_view msg, std::string_view id) {
+    auto uid = std::string(id);
+    if (ignore.contains(uid)) ignored.insert(uid);
+    else if (auto p = mbox.find(uid); p) mails.push_back(*p);
+    else news.emplace_back(msg, uid);
+  });
+  for (auto p = news.cbegin(); p != news.cend();) {
+    std::vector<std::string> cmds;
+    for (auto q = p; q != news.cend() && cmds.size() < (_pipelining ? 64u : 1u); ++q) {
+      cmds.push_back("TOP " + q->first + " 0");
     }
-    if (recent) {
-      ignored.push_back(uid);
+    _send(cmds);
+    for (auto n = cmds.size(); n--; ++p) {
+      auto& uid = p->second;
+      LOG("Fetch mail: " << uid << std::endl);
+      _ok();
+      mail m(uid);
+      if (m.header(_headers())) {
+	ignored.insert(uid);
+	continue;
+      }
+      if (recent) ignored.insert(uid);
       recents.push_back(m);
-    } else {
-      (mbox.find(uid) ? &mails : &recents)->push_back(m);
     }
   }
   auto count = recents.size();
-  mails.splice(mails.end(), recents);
+  for (auto const& m : recents) mails.push_back(m);
   auto lock = mbox.lock();
   mbox.mails(mails);
   mbox.ignore(ignored);
   return count;
 }
 
+void
+pop3::_send(std::vector<std::string> const& cmds)
+{
+  // send the commands at once for PIPELINING (RFC 2449).
+  std::string data;
+  for (auto const& cmd : cmds) {
+    LOG("S: " << cmd << std::endl);
+    data += cmd + "\015\012";
+  }
+  write(data.data(), data.size());
+}
+
 bool
 pop3::_command(std::string const& cmd, bool ok)
 {
@@ -117,14 +146,13 @@ pop3::_ok(bool ok)
   return resp;
 }
 
-pop3::plist
-pop3::_plist(bool upper)
+void
+pop3::_plist(pfunc const& f, bool upper)
 {
-  plist result;
   for (;;) {
     auto line = read();
-    plist::value_type ps;
-    if (std::string_view sv = line; !sv.empty()) {
+    std::string_view sv = line, first, second;
+    if (!sv.empty()) {
       if (sv[0] == '.') {
 	if (sv.size() == 1) break;
 	sv = sv.substr(1);
@@ -134,14 +162,23 @@ pop3::_plist(bool upper)
 	sv = std::string_view(line);
       }
       auto i = sv.find(' ');
-      ps.first = sv.substr(0, i);
+      first = sv.substr(0, i);
       if (i != sv.npos) {
 	i = sv.find_first_not_of(' ', i);
-	if (i != sv.npos) ps.second = sv.substr(i);
+	if (i != sv.npos) second = sv.substr(i);
       }
     }
-    result.push_back(ps);
+    f(first, second);
   }
+}
+
+pop3::plist
+pop3::_plist(bool upper)
+{
+  plist result;
+  _plist([&result](std::string_view first, std::string_view second) {
+    result.emplace_back(first, second);
+  }, upper);
   return result;
 }
 
@@ -5,6 +5,8 @@
  * the license terms, see the LICENSE.txt file included with the program.
  */
 #include "stdafx.h"
+#include "inifile.h"
+#include <imagehlp.h>
 
 /*
  * Functions of class setting
@@ -90,12 +92,14 @@ setting::cache(std::string_view key, std::list<std::string> const& data)
 }
 
 void
-setting::cacheclear()
+setting::cacheclear(std::unordered_set<std::string> const& keep)
 {
   assert(_rep);
+  std::unordered_set<std::string> kept;
+  for (auto const& key : keep) kept.insert(_cachekey(key));
   for (auto const& key : _rep->storages()) {
     if (!key.empty() && *key.rbegin() == ')' &&
-	key.starts_with("(cache:")) _rep->erase(key);
+	key.starts_with("(cache:") && !kept.contains(key)) _rep->erase(key);
   }
 }
 
@@ -166,6 +170,89 @@ setting::cipher(_str key, std::string const& value)
   return *this;
 }
 
+/*
+ * Functions of class setting::repository
+ */
+std::string
+setting::repository::cachedir() const
+{
+  char path[MAX_PATH];
+  if (SHGetFolderPath({}, CSIDL_LOCAL_APPDATA | CSIDL_FLAG_CREATE,
+		      {}, SHGFP_TYPE_CURRENT, path) != S_OK ||
+      !PathAppend(path, APP_NAME "\\cache")) return {};
+  return path;
+}
+
+/*
+ * Functions of class setting::uidcache
+ */
+setting::uidcache::uidcache(std::string_view name, std::string_view uri)
+  : uidjournal(name, uri)
+{
+  assert(_rep);
+  auto dir = _rep->cachedir();
+  if (dir.empty()) return;
+  char file[20];
+  sprintf_s(file, "%016llx.uid", hash());
+  _path = dir + '\\' + file;
+}
+
+bool
+setting::uidcache::load(std::unordered_set<std::string>& uids)
+{
+  if (_path.empty()) return false;
+  auto h = CreateFile(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, {},
+		      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, {});
+  if (h == INVALID_HANDLE_VALUE) return false;
+  auto ok = false;
+  if (LARGE_INTEGER size; GetFileSizeEx(h, &size) && size.QuadPart > 0 &&
+      size.QuadPart < 0x40000000) {
+    if (auto map = CreateFileMapping(h, {}, PAGE_READONLY, 0, 0, {}); map) {
+      if (auto p = MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0); p) {
+	ok = _parse(std::string_view(static_cast<char const*>(p), size_t(size.QuadPart)));
+	UnmapViewOfFile(p);
+      }
+      CloseHandle(map);
+    }
+  }
+  CloseHandle(h);
+  if (ok) uids = this->uids();
+  return ok;
+}
+
+void
+setting::uidcache::_append(size_t pos, std::string const& data)
+{
+  auto h = CreateFile(_path.c_str(), GENERIC_WRITE, 0, {},
+		      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, {});
+  win32::valid(h != INVALID_HANDLE_VALUE);
+  LARGE_INTEGER li;
+  li.QuadPart = pos;
+  DWORD n;
+  auto ok = SetFilePointerEx(h, li, {}, FILE_BEGIN) &&
+    WriteFile(h, data.data(), DWORD(data.size()), &n, {}) && n == data.size() &&
+    SetEndOfFile(h);
+  CloseHandle(h);
+  win32::valid(ok);
+}
+
+void
+setting::uidcache::_replace(std::string const& data)
+{
+  auto tmp = _path + ".tmp";
+  MakeSureDirectoryPathExists(tmp.c_str());
+  auto h = CreateFile(tmp.c_str(), GENERIC_WRITE, 0, {},
+		      CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, {});
+  win32::valid(h != INVALID_HANDLE_VALUE);
+  DWORD n;
+  auto ok = WriteFile(h, data.data(), DWORD(data.size()), &n, {}) && n == data.size();
+  CloseHandle(h);
+  if (!ok || !MoveFileEx(tmp.c_str(), _path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+    DeleteFile(tmp.c_str());
+    throw win32::error();
+  }
+}
+
 /*
  * Functions of class setting::tuple
  */
@@ -339,20 +426,20 @@ setting::registory(_str key)
 
 #else // !USE_REG
 /** _profile - implement for setting::repository
- * This is using Windows API for .INI file.
+ * This is using the in-memory model of .INI file.
  */
 class setting::_profile : public setting::repository {
-  std::string _path;
+  std::unique_ptr<inifile> _ini;
 public:
-  _profile(_str path) : _path(path) {}
-  ~_profile() { win32::profile({}, {}, {}, _path.c_str()); }
+  _profile(_str path) : _ini(new inifile(path.c_str)) {}
+  ~_profile() { try { _ini->flush(); } catch (...) {} }
 public:
   std::unique_ptr<setting::storage> storage(_str name) const override;
-  std::list<std::string> storages() const override
-  { return setting::manip(win32::profile({}, {}, _path.c_str())).sep(0).split(); }
-  void erase(_str name) override { win32::profile(name, {}, {}, _path.c_str()); }
+  std::list<std::string> storages() const override { return _ini->sections(); }
+  void erase(_str name) override { _ini->erase(name.c_str); }
   char const* invalidchars() const noexcept override { return "]"; }
   std::unique_ptr<setting::watch> watch() const override;
+  std::string cachedir() const override;
 };
 
 std::unique_ptr<setting::storage>
@@ -360,48 +447,49 @@ setting::_profile::storage(_str name) const
 {
   class section : public setting::storage {
     std::string _section;
-    char const* _path;
+    inifile& _ini;
   public:
-    section(char const* section, char const* path)
-      : _section(section), _path(path) {}
-    std::string get(_str key) const override
-    { return win32::profile(_section.c_str(), key, _path); }
+    section(char const* section, inifile& ini)
+      : _section(section), _ini(ini) {}
+    std::string get(_str key) const override { return _ini.get(_section, key.c_str); }
     void put(_str key, _str value) override {
       std::string v;
       if (value) v.assign(value);
       if (!v.empty() && v[0] == '"' && *v.rbegin() == '"') v = '"' + v + '"';
-      if (v != get(key)) win32::profile(_section.c_str(), key, v.c_str(), _path);
+      _ini.put(_section, key.c_str, v);
     }
-    void erase(_str key) override { win32::profile(_section.c_str(), key, {}, _path); }
-    std::list<std::string> keys() const override
-    { return setting::manip(get({})).sep(0).split(); }
+    void erase(_str key) override { _ini.erase(_section, key.c_str); }
+    std::list<std::string> keys() const override { return _ini.keys(_section); }
   };
-  return std::unique_ptr<setting::storage>(new section(name, _path.c_str()));
+  return std::unique_ptr<setting::storage>(new section(name, *_ini));
 }
 
 std::unique_ptr<setting::watch>
 setting::_profile::watch() const
 {
-  if (_path.empty()) return {};
+  if (_ini->path().empty()) return {};
   class watch : public setting::watch {
-    HANDLE _h;
-    FILETIME _time;
+    inifile& _ini;
+    unsigned long _generation;
   public:
-    watch(LPCSTR path)
-      : _h(CreateFile(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
-		      {}, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, {})) {
-      win32::valid(_h != INVALID_HANDLE_VALUE);
-      GetFileTime(_h, {}, {}, &_time);
-    }
-    ~watch() { CloseHandle(_h); }
-    bool changed() const noexcept {
-      auto after = _time;
-      GetFileTime(_h, {}, {}, &after);
-      return CompareFileTime(&_time, &after) != 0;
+    watch(inifile& ini) : _ini(ini), _generation(ini.generation()) {}
+    bool changed() const noexcept override {
+      try { _ini.flush(); } catch (...) {}
+      return _ini.generation() != _generation;
     }
   };
-  WritePrivateProfileString({}, {}, {}, _path.c_str()); // flush entries.
-  return std::unique_ptr<setting::watch>(new watch(_path.c_str()));
+  _ini->flush(), _ini->refresh(); // take in the file edited by hand.
+  return std::unique_ptr<setting::watch>(new watch(*_ini));
+}
+
+std::string
+setting::_profile::cachedir() const
+{
+  // put the cache beside the .INI file.
+  auto& path = _ini->path();
+  auto n = path.find_last_of('\\');
+  if (n == path.npos) return repository::cachedir();
+  return path.substr(0, n + 1) + "cache";
 }
 
 std::unique_ptr<setting::repository>
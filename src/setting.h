@@ -6,9 +6,12 @@
  */
 #pragma once
 
+#include "uidjournal.h"
 #include <list>
 #include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_set>
 
 class setting {
   struct _str {
@@ -42,6 +45,7 @@ class setting {
     virtual void erase(_str name) = 0;
     virtual char const* invalidchars() const noexcept = 0;
     virtual std::unique_ptr<setting::watch> watch() const = 0;
+    virtual std::string cachedir() const;
   };
   static inline repository* _rep = {};
   std::unique_ptr<storage> _st;
@@ -109,11 +113,26 @@ public:
   static void mailboxclear(std::string const& id);
   static std::list<std::string> cache(std::string_view key);
   static void cache(std::string_view key, std::list<std::string> const& data);
-  static void cacheclear();
+  static void cacheclear(std::unordered_set<std::string> const& keep = {});
   static char const* invalidchars();
   static bool edit();
 public:
   std::string cipher(_str key);
   setting& cipher(_str key, std::string const& value);
   setting& erase(_str key) { _st->erase(key); return *this; }
+public:
+  // uidcache - persistent cache of UIDs for a mailbox.
+  // This is the journal stored in the file named by the hash.
+  // It's false when the file isn't available, then the cache should be
+  // kept in the settings instead.
+  class uidcache : public uidjournal {
+    std::string _path;
+    bool _available() const noexcept override { return !_path.empty(); }
+    void _append(size_t pos, std::string const& data) override;
+    void _replace(std::string const& data) override;
+  public:
+    uidcache() {}
+    uidcache(std::string_view name, std::string_view uri);
+    bool load(std::unordered_set<std::string>& uids);
+  };
 };
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#include "uidjournal.h"
+
+/*
+ * Functions of class uidjournal
+ * The journal consists of the header "BFUC", version, FNV-1a hash of the
+ * key in 8 bytes, and records. Each record is an operation '+' or '-',
+ * length of the UID, and the UID. The length is given by 7 bits in each
+ * byte from the lowest, and the byte with the highest bit is followed by
+ * the next. The key is the mailbox name and URI.
+ */
+#define UIDJOURNAL_MAGIC "BFUC\x03"
+#define UIDJOURNAL_SLACK 64 // obsolete records allowed before compaction.
+
+uidjournal::uidjournal(std::string_view name, std::string_view uri)
+  : _header(UIDJOURNAL_MAGIC)
+{
+  auto h = 0xcbf29ce484222325ULL; // FNV-1a
+  auto hash = [&h](std::string_view s) {
+    for (auto c : s) h = (h ^ (c & 255)) * 0x100000001b3ULL;
+  };
+  hash(name), hash({ "\0", 1 }), hash(uri);
+  for (auto i = 0; i < 64; i += 8) _header += char(h >> i);
+  _hash = h;
+}
+
+void
+uidjournal::_record(std::string& data, char op, std::string const& uid)
+{
+  data += op;
+  auto n = uid.size();
+  for (; n >= 128; n >>= 7) data += char(n & 127 | 128);
+  data += char(n);
+  data += uid;
+}
+
+bool
+uidjournal::_parse(std::string_view data)
+{
+  if (_header.empty() || !data.starts_with(_header)) return false;
+  _uids.clear(), _records = 0;
+  auto i = _header.size();
+  while (i < data.size() && (data[i] == '+' || data[i] == '-')) {
+    size_t n = 0, j = i + 1;
+    unsigned c = 128;
+    for (unsigned shift = 0; c & 128 && j < data.size() && shift < 28; shift += 7) {
+      c = data[j++] & 255;
+      n |= size_t(c & 127) << shift;
+    }
+    if (c & 128 || n > data.size() - j) break;
+    std::string uid(data.substr(j, n));
+    data[i] == '+' ? (void)_uids.insert(uid) : (void)_uids.erase(uid);
+    ++_records, i = j + n;
+  }
+  _end = i; // the rest is a torn record.
+  return true;
+}
+
+void
+uidjournal::update(std::unordered_set<std::string> const& uids)
+{
+  if (!_available()) return;
+  std::string data;
+  size_t records = 0;
+  for (auto p = _uids.begin(); p != _uids.end();) {
+    if (uids.contains(*p)) ++p;
+    else _record(data, '-', *p), ++records, p = _uids.erase(p);
+  }
+  for (auto const& uid : uids) {
+    if (_uids.insert(uid).second) _record(data, '+', uid), ++records;
+  }
+  if (_end && !records) return;
+  if (!_end || _records + records > _uids.size() * 2 + UIDJOURNAL_SLACK) return compact();
+  _append(_end, data);
+  _end += data.size(), _records += records;
+}
+
+void
+uidjournal::compact()
+{
+  if (!_available()) return;
+  auto data = _header;
+  for (auto const& uid : _uids) _record(data, '+', uid);
+  if (_end == data.size() && _records == _uids.size()) return;
+  _replace(data);
+  _end = data.size(), _records = _uids.size();
+}
@@ -0,0 +1,39 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+/** uidjournal - append-only journal of added and removed UIDs.
+ * The journal is compacted when it contains too many obsolete records.
+ * It's stored by the derived class, which writes the data given by
+ * _append and _replace.
+ */
+class uidjournal {
+  std::string _header;
+  unsigned long long _hash = 0;
+  std::unordered_set<std::string> _uids; // UIDs stored in the journal.
+  size_t _records = 0;   // number of records in the journal.
+  size_t _end = 0;       // end of the valid records.
+  static void _record(std::string& data, char op, std::string const& uid);
+protected:
+  uidjournal() {}
+  uidjournal(std::string_view name, std::string_view uri);
+  ~uidjournal() {}
+  bool _parse(std::string_view data);
+  virtual bool _available() const noexcept = 0;
+  virtual void _append(size_t pos, std::string const& data) = 0; // and truncate the rest.
+  virtual void _replace(std::string const& data) = 0;
+public:
+  auto hash() const noexcept { return _hash; }
+  auto const& uids() const noexcept { return _uids; }
+  explicit operator bool() const noexcept { return _end != 0; }
+  void update(std::unordered_set<std::string> const& uids);
+  void compact();
+};
@@ -5,6 +5,7 @@
  * the license terms, see the LICENSE.txt file included with the program.
  */
 #include "stdafx.h"
+#include "charset.h"
 
 /*
  * Functions of the class win32
@@ -49,27 +50,6 @@ win32::hexdigit(unsigned value)
   return _ultoa_s(value, s, 16) == 0 ? s : std::string();
 }
 
-std::string
-win32::profile(LPCSTR section, LPCSTR key, LPCSTR file)
-{
-  if (!file) return {};
-  std::unique_ptr<char[]> buf;
-  DWORD size = 0;
-  for (DWORD n = 0; n <= size + 2;) {
-    n += 256;
-    buf = std::unique_ptr<char[]>(new char[n]);
-    size = GetPrivateProfileString(section, key, "", buf.get(), n, file);
-  }
-  std::string_view sv(buf.get(), size);
-  return std::string(sv.substr(min(sv.find_first_not_of("\t "), sv.size())));
-}
-
-void
-win32::profile(LPCSTR section, LPCSTR key, LPCSTR value, LPCSTR file)
-{
-  file && WritePrivateProfileString(section, key, value, file);
-}
-
 std::string
 win32::xenv(std::string const& s)
 {
@@ -211,6 +191,7 @@ win32::u8conv::operator()(std::string const& text)
 {
   if (!*this) throw text;
   if (_codepage == CP_UTF8) return text;
+  if (std::string s; u8decode(_codepage, text, s, _mode)) return s;
   if (!_mb2u) return win32::string(win32::wstring(text, _codepage), CP_UTF8);
   int n = 0;
   if (_mb2u(&_mode, _codepage, text.c_str(), {}, {}, &n) != S_OK) throw text;
@@ -23,8 +23,6 @@ public:
   static std::string digit(int value);
   static std::string hexdigit(unsigned value);
 
-  static std::string profile(LPCSTR section, LPCSTR key, LPCSTR file);
-  static void profile(LPCSTR section, LPCSTR key, LPCSTR value, LPCSTR file);
   static std::string xenv(std::string const& s);
   static std::string date(time_t utc, DWORD flags = 0)
   { return _datetime(utc, flags, GetDateFormat); }
@@ -5,6 +5,10 @@
  * the license terms, see the LICENSE.txt file included with the program.
  */
 #include "stdafx.h"
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 /*
  * Functions of the class winsock
@@ -18,6 +22,51 @@ winsock::winsock()
       int(HIBYTE(wsa.wHighVersion)) << '.' << int(LOBYTE(wsa.wHighVersion)) << std::endl);
 }
 
+#define RESOLVE_TTL 300000   // ms to keep resolved addresses.
+#define RESOLVE_NEGTTL 30000 // ms to keep resolution errors.
+
+namespace {
+  std::shared_ptr<addrinfo>
+  lookup(std::string const& host, std::string const& port, int domain)
+  {
+    struct addrinfo* ai;
+    struct addrinfo hints { 0, domain, SOCK_STREAM };
+    auto err = getaddrinfo(winsock::idn(host).c_str(), port.c_str(), &hints, &ai);
+    if (err) {
+      WSASetLastError(err);
+      throw winsock::error();
+    }
+    return std::shared_ptr<addrinfo>(ai, freeaddrinfo);
+  }
+
+  // resolved addresses shared by the process.
+  resolvecache<std::shared_ptr<addrinfo>> resolver(lookup, GetTickCount64, RESOLVE_TTL, RESOLVE_NEGTTL);
+}
+
+winsock::~winsock()
+{
+  resolver.join(); // the prefetching threads end before the cleanup.
+  WSACleanup();
+}
+
+std::shared_ptr<addrinfo>
+winsock::resolve(std::string const& host, std::string const& port, int domain)
+{
+  return resolver.resolve(host, port, domain);
+}
+
+void
+winsock::prefetch(std::string const& host, std::string const& port, int domain)
+{
+  resolver.prefetch(host, port, domain);
+}
+
+void
+winsock::forget(std::string const& host, std::string const& port, int domain)
+{
+  resolver.forget(host, port, domain);
+}
+
 std::string
 winsock::error::emsg()
 {
@@ -27,31 +76,91 @@ winsock::error::emsg()
 /*
  * Functions of the class winsock::tcpclient
  */
+namespace {
+  eyeballs attempts; // shared to remember the family connected lastly.
+}
+
 winsock::tcpclient&
 winsock::tcpclient::connect(std::string const& host, std::string const& port, int domain)
 {
-  shutdown();
   LOG("Connect: " << host << "(" << idn(host) << "):" << port << std::endl);
-  struct addrinfo* ai;
-  {
-    struct addrinfo hints { 0, domain, SOCK_STREAM };
-    auto err = getaddrinfo(idn(host).c_str(), port.c_str(), &hints, &ai);
-    if (err) {
-      WSASetLastError(err);
-      throw error();
-    }
+  auto ai = resolve(host, port, domain);
+  try {
+    return connect(ai.get(), host);
+  } catch (error const&) {
+    forget(host, port, domain); // the addresses may be obsolete.
+    throw;
   }
-  for (auto p = ai; p; p = p->ai_next) {
-    auto s = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
-    if (s == INVALID_SOCKET) continue;
-    if (::connect(s, p->ai_addr, int(p->ai_addrlen)) == 0) {
-      _socket = s;
+}
+
+winsock::tcpclient&
+winsock::tcpclient::connect(struct addrinfo const* ai, std::string const& host)
+{
+  shutdown();
+  // start the connection attempts one by one with the delay, and
+  // take the first one which is established.
+  auto addrs = attempts.order(ai, host);
+  std::vector<std::pair<SOCKET, int>> pending;
+  int err = WSAEHOSTUNREACH;
+  auto next = addrs.begin();
+  auto start = GetTickCount64();
+  while (_socket == INVALID_SOCKET) {
+    if (next != addrs.end() && pending.size() < FD_SETSIZE) {
+      auto p = *next++;
+      auto s = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
+      if (s == INVALID_SOCKET) continue;
+      if (u_long nb = 1; ioctlsocket(s, FIONBIO, &nb) != 0 ||
+	  ::connect(s, p->ai_addr, int(p->ai_addrlen)) != 0 &&
+	  WSAGetLastError() != WSAEWOULDBLOCK) {
+	err = WSAGetLastError();
+	closesocket(s);
+	continue;
+      }
+      pending.emplace_back(s, p->ai_family);
+    }
+    if (pending.empty()) break;
+    auto wait = eyeballs::wait(next != addrs.end(), GetTickCount64() - start);
+    if (!wait) {
+      err = WSAETIMEDOUT;
       break;
     }
-    closesocket(s);
+    fd_set wfds, efds;
+    FD_ZERO(&wfds);
+    FD_ZERO(&efds);
+    for (auto const& [s, family] : pending) {
+      FD_SET(s, &wfds);
+      FD_SET(s, &efds);
+    }
+    timeval tv { long(wait / 1000), long(wait % 1000 * 1000) };
+    if (select(0, {}, &wfds, &efds, &tv) == SOCKET_ERROR) {
+      err = WSAGetLastError();
+      break;
+    }
+    for (auto p = pending.begin(); p != pending.end();) {
+      auto [s, family] = *p;
+      if (!FD_ISSET(s, &wfds) && !FD_ISSET(s, &efds)) {
+	++p;
+	continue;
+      }
+      int e = 0, n = sizeof(e);
+      if (getsockopt(s, SOL_SOCKET, SO_ERROR, LPSTR(&e), &n) != 0) e = WSAGetLastError();
+      if (!e) {
+	_socket = s, pending.erase(p);
+	LOG("Connected: " << (family == AF_INET6 ? "IPv6" : "IPv4") << std::endl);
+	attempts.connected(host, family);
+	break;
+      }
+      err = e;
+      closesocket(s);
+      p = pending.erase(p);
+    }
   }
-  freeaddrinfo(ai);
-  if (_socket == INVALID_SOCKET) throw error();
+  for (auto const& [s, family] : pending) closesocket(s);
+  if (_socket == INVALID_SOCKET) {
+    WSASetLastError(err);
+    throw error();
+  }
+  if (u_long nb = 0; ioctlsocket(_socket, FIONBIO, &nb) != 0) throw error();
   return *this;
 }
 
@@ -110,20 +219,6 @@ winsock::tcpclient::timeout(int sec)
 /*
  * Functions of the class winsock::tlsclient
  */
-winsock::tlsclient::tlsclient()
-{
-  SEC_CHAR pkg[] = UNISP_NAME;
-  SCHANNEL_CRED auth { SCHANNEL_CRED_VERSION };
-  auth.dwFlags = (SCH_CRED_USE_DEFAULT_CREDS | SCH_CRED_MANUAL_CRED_VALIDATION);
-  _ok(AcquireCredentialsHandle({}, pkg, SECPKG_CRED_OUTBOUND, {}, &auth, {}, {}, &_cred, {}));
-}
-
-winsock::tlsclient::~tlsclient()
-{
-  assert(!_ctx);
-  FreeCredentialsHandle(&_cred);
-}
-
 class winsock::tlsclient::error : public winsock::error {
 public:
   error(SECURITY_STATUS ss) : winsock::error("SSPI error #0x" + win32::hexdigit(ss)) {}
@@ -136,6 +231,34 @@ winsock::tlsclient::_ok(SECURITY_STATUS ss) const
   return ss;
 }
 
+namespace {
+  handshakes tlsstats;
+}
+
+CredHandle*
+winsock::tlsclient::_credential()
+{
+  // Schannel caches TLS sessions per credential and target name, so the
+  // credential is shared by the process to resume sessions.
+  static struct cred : CredHandle {
+    cred() {
+      SEC_CHAR pkg[] = UNISP_NAME;
+      SCHANNEL_CRED auth { SCHANNEL_CRED_VERSION };
+      auth.dwFlags = (SCH_CRED_USE_DEFAULT_CREDS | SCH_CRED_MANUAL_CRED_VALIDATION);
+      _ok(AcquireCredentialsHandle({}, pkg, SECPKG_CRED_OUTBOUND, {}, &auth, {}, {}, this, {}));
+    }
+    ~cred() { FreeCredentialsHandle(this); }
+    static void _ok(SECURITY_STATUS ss) { if (FAILED(ss)) throw error(ss); }
+  } cred;
+  return &cred;
+}
+
+winsock::tlsclient::statistics
+winsock::tlsclient::stats()
+{
+  return tlsstats.get();
+}
+
 SECURITY_STATUS
 winsock::tlsclient::_init(SecBufferDesc* inb)
 {
@@ -149,7 +272,7 @@ winsock::tlsclient::_init(SecBufferDesc* inb)
     ~obuf() { if (pvBuffer) FreeContextBuffer(pvBuffer); }
   } out;
   SecBufferDesc outb { SECBUFFER_VERSION, 1, &out };
-  auto ss = InitializeSecurityContext(&_cred, _ctx, {}, req, 0, 0,
+  auto ss = InitializeSecurityContext(_credential(), _ctx, _host.data(), req, 0, 0,
 				      inb, 0, &_ctxb, &outb, &attr, {});
   _ctx = &_ctxb;
   switch (ss) {
@@ -170,27 +293,19 @@ winsock::tlsclient::_send(char const* data, size_t size)
 }
 
 winsock::tlsclient&
-winsock::tlsclient::connect()
+winsock::tlsclient::connect(std::string const& host)
 {
+  _host = idn(host);
   try {
-    size_t n = 0;
-    if (_rbuf.empty()) _rbuf.resize(16 * 1024);
-    for (auto ss = _init(); ss == SEC_I_CONTINUE_NEEDED;) {
-      if (_remain) n = _remain, _remain = 0;
-      else if (auto t = recvlo(_rbuf.data() + n, _rbuf.size() - n); t) n += t;
-      else throw error(SEC_E_INCOMPLETE_MESSAGE);
-      SecBuffer in[2] { { DWORD(n), SECBUFFER_TOKEN, _rbuf.data() } };
-      SecBufferDesc inb { SECBUFFER_VERSION, 2, in };
-      if (ss = _init(&inb); ss == SEC_E_INCOMPLETE_MESSAGE) {
-	if (n < _rbuf.size()) ss = SEC_I_CONTINUE_NEEDED;
-      } else if (in[1].BufferType == SECBUFFER_EXTRA) {
-	_remain = in[1].cbBuffer;
-	MoveMemory(_rbuf.data(), _rbuf.data() + in[0].cbBuffer - _remain, _remain);
-      } else n = 0;
-      _ok(ss);
-    }
-    _ok(QueryContextAttributes(_ctx, SECPKG_ATTR_STREAM_SIZES, &_sizes));
-    _rbuf.resize(_sizes.cbHeader + _sizes.cbMaximumMessage + _sizes.cbTrailer);
+    auto start = GetTickCount64();
+    _handshake();
+    SecPkgContext_SessionInfo info {};
+    auto resumed = (QueryContextAttributes(_ctx, SECPKG_ATTR_SESSION_INFO, &info) == SEC_E_OK &&
+		    info.dwFlags & SSL_SESSION_RECONNECT);
+    auto elapse = GetTickCount64() - start;
+    tlsstats.add(resumed, elapse);
+    LOG("TLS: " << (resumed ? "resumed" : "full") << " handshake " << elapse << "ms (" <<
+	tlsstats.get().full << " full, " << tlsstats.get().resumed << " resumed)." << std::endl);
   } catch (...) {
     shutdown();
     throw;
@@ -198,11 +313,34 @@ winsock::tlsclient::connect()
   return *this;
 }
 
+void
+winsock::tlsclient::_handshake()
+{
+  size_t n = 0;
+  if (_rbuf.empty()) _rbuf.resize(16 * 1024);
+  for (auto ss = _init(); ss == SEC_I_CONTINUE_NEEDED;) {
+    if (_remain) n = _remain, _remain = 0;
+    else if (auto t = recvlo(_rbuf.data() + n, _rbuf.size() - n); t) n += t;
+    else throw error(SEC_E_INCOMPLETE_MESSAGE);
+    SecBuffer in[2] { { DWORD(n), SECBUFFER_TOKEN, _rbuf.data() } };
+    SecBufferDesc inb { SECBUFFER_VERSION, 2, in };
+    if (ss = _init(&inb); ss == SEC_E_INCOMPLETE_MESSAGE) {
+      if (n < _rbuf.size()) ss = SEC_I_CONTINUE_NEEDED;
+    } else if (in[1].BufferType == SECBUFFER_EXTRA) {
+      _remain = in[1].cbBuffer;
+      MoveMemory(_rbuf.data(), _rbuf.data() + in[0].cbBuffer - _remain, _remain);
+    } else n = 0;
+    _ok(ss);
+  }
+  _ok(QueryContextAttributes(_ctx, SECPKG_ATTR_STREAM_SIZES, &_sizes));
+  _rbuf.resize(_sizes.cbHeader + _sizes.cbMaximumMessage + _sizes.cbTrailer);
+}
+
 winsock::tlsclient&
 winsock::tlsclient::shutdown() noexcept
 {
   if (_ctx) {
-    _recvq.clear(), _remain = 0;
+    _plain = {}, _extra = _remain = 0, _renegotiate = false;
     if (availlo()) {
       try {
 	DWORD value = SCHANNEL_SHUTDOWN;
@@ -220,86 +358,137 @@ winsock::tlsclient::shutdown() noexcept
   return *this;
 }
 
+#define VERIFY_TTL 3600000 // ms to trust a verified certificate.
+
+namespace {
+  verifycache verified(GetTickCount64, VERIFY_TTL);
+}
+
 bool
 winsock::tlsclient::verify(std::string const& cn, DWORD ignore)
 {
   LOG("Auth: " << cn << "(" << idn(cn) << ")... ");
   auto name = win32::wstring(idn(cn));
-  PCCERT_CHAIN_CONTEXT chain;
+  PCCERT_CONTEXT context;
+  _ok(QueryContextAttributes(_ctx, SECPKG_ATTR_REMOTE_CERT_CONTEXT, &context));
+  std::string fingerprint;
   {
-    PCCERT_CONTEXT context;
-    _ok(QueryContextAttributes(_ctx, SECPKG_ATTR_REMOTE_CERT_CONTEXT, &context));
-    CERT_CHAIN_PARA ccp { sizeof(ccp) };
-    auto ok = CertGetCertificateChain({}, context, {}, context->hCertStore, &ccp, 0, {}, &chain);
+    BYTE hash[32];
+    DWORD n = sizeof(hash);
+    if (CryptHashCertificate2(L"SHA256", 0, {}, context->pbCertEncoded,
+			      context->cbCertEncoded, hash, &n)) {
+      fingerprint.assign(LPCSTR(hash), n);
+    }
+  }
+  auto cached = true;
+  auto ok = verified.verify(idn(cn), ignore, fingerprint, [&] {
+    cached = false;
+    PCCERT_CHAIN_CONTEXT chain;
+    {
+      CERT_CHAIN_PARA ccp { sizeof(ccp) };
+      auto ok = CertGetCertificateChain({}, context, {}, context->hCertStore, &ccp, 0, {}, &chain);
+      CertFreeCertificateContext(context);
+      win32::valid(ok);
+    }
+    CERT_CHAIN_POLICY_STATUS status { sizeof(status) };
+    {
+      CERT_CHAIN_POLICY_PARA policy { sizeof(policy) };
+      SSL_EXTRA_CERT_CHAIN_POLICY_PARA ssl { sizeof(ssl) };
+      ssl.dwAuthType = AUTHTYPE_SERVER;
+      ssl.fdwChecks = ignore;
+      ssl.pwszServerName = const_cast<LPWSTR>(name.c_str());
+      policy.pvExtraPolicyPara = &ssl;
+      auto ok = CertVerifyCertificateChainPolicy(CERT_CHAIN_POLICY_SSL, chain, &policy, &status);
+      CertFreeCertificateChain(chain);
+      win32::valid(ok);
+    }
+    LOG(status.dwError << std::endl);
+    return status.dwError == 0;
+  });
+  if (cached) {
     CertFreeCertificateContext(context);
-    win32::valid(ok);
+    LOG("cached" << std::endl);
   }
-  CERT_CHAIN_POLICY_STATUS status { sizeof(status) };
-  {
-    CERT_CHAIN_POLICY_PARA policy { sizeof(policy) };
-    SSL_EXTRA_CERT_CHAIN_POLICY_PARA ssl { sizeof(ssl) };
-    ssl.dwAuthType = AUTHTYPE_SERVER;
-    ssl.fdwChecks = ignore;
-    ssl.pwszServerName = const_cast<LPWSTR>(name.c_str());
-    policy.pvExtraPolicyPara = &ssl;
-    auto ok = CertVerifyCertificateChainPolicy(CERT_CHAIN_POLICY_SSL, chain, &policy, &status);
-    CertFreeCertificateChain(chain);
-    win32::valid(ok);
+  return ok;
+}
+
+void
+winsock::tlsclient::_rewind() noexcept
+{
+  // move the received data which is not decrypted yet to the head.
+  if (_remain && _extra) MoveMemory(_rbuf.data(), _rbuf.data() + _extra, _remain);
+  _extra = 0;
+}
+
+void
+winsock::tlsclient::_renegotiation()
+{
+  _renegotiate = false;
+  try {
+    _rewind();
+    _handshake();
+  } catch (...) {
+    shutdown();
+    throw;
   }
-  LOG(status.dwError << std::endl);
-  return !status.dwError;
 }
 
-size_t
-winsock::tlsclient::recv(char* buf, size_t size)
+std::string_view
+winsock::tlsclient::recv()
 {
   assert(_ctx);
-  if (!_recvq.empty()) {
-    auto n = min(size, _recvq.size() - _rest);
-    CopyMemory(buf, _recvq.data() + _rest, n);
-    _rest += n;
-    if (_rest == _recvq.size()) _recvq.clear();
-    return n;
-  }
-  _rest = 0;
-  size_t done = 0;
-  for (size_t n = 0; size && !done;) {
+  if (!_plain.empty()) return std::exchange(_plain, {});
+  if (_renegotiate) _renegotiation();
+  else _rewind();
+  for (size_t n = 0;;) {
     if (_remain) n = _remain, _remain = 0;
     else if (auto t = recvlo(_rbuf.data() + n, _sizes.cbMaximumMessage - n); t) n += t;
-    else if (n == 0) break;
+    else if (n == 0) return {};
     else throw error(SEC_E_INCOMPLETE_MESSAGE);
     SecBuffer dec[4] { { DWORD(n), SECBUFFER_DATA, _rbuf.data() } };
     SecBufferDesc decb { SECBUFFER_VERSION, 4, dec };
     auto ss = DecryptMessage(_ctx, &decb, 0, {});
     if (ss == SEC_E_INCOMPLETE_MESSAGE && n < _sizes.cbMaximumMessage) continue;
-    _ok(ss), n = 0;
+    _ok(ss);
+    std::string_view plain;
     for (auto const& sec : dec) {
       switch(sec.BufferType) {
       case SECBUFFER_DATA:
 	if (sec.cbBuffer) {
-	  size_t m = 0;
-	  if (done < size) {
-	    m = min(size - done, sec.cbBuffer);
-	    CopyMemory(buf + done, sec.pvBuffer, m);
-	    done += m;
-	  }
-	  _recvq.append(LPCSTR(sec.pvBuffer) + m, sec.cbBuffer - m);
+	  plain = { LPCSTR(sec.pvBuffer), sec.cbBuffer };
 	} else if (ss == SEC_E_OK && _rbuf[0] == 0x15) {
 	  ss = SEC_I_CONTEXT_EXPIRED; // for Win2kPro
 	}
 	break;
       case SECBUFFER_EXTRA:
-	MoveMemory(_rbuf.data() + _remain, sec.pvBuffer, sec.cbBuffer);
-	_remain += sec.cbBuffer;
+	// the decrypted data is in front of the extra data.
+	_extra = n - sec.cbBuffer, _remain = sec.cbBuffer;
 	break;
       }
     }
-    if (ss == SEC_I_CONTEXT_EXPIRED && !done) {
+    if (ss == SEC_I_CONTEXT_EXPIRED && plain.empty()) {
       throw error(SEC_E_CONTEXT_EXPIRED);
     }
-    if (ss == SEC_I_RENEGOTIATE) connect();
+    if (ss == SEC_I_RENEGOTIATE) {
+      // the handshake reuses _rbuf, so it's deferred after the plain
+      // data in _rbuf is taken.
+      if (!plain.empty()) return _renegotiate = true, plain;
+      _renegotiation(), n = 0;
+      continue;
+    }
+    if (!plain.empty()) return plain;
+    _rewind(), n = 0;
   }
-  return done;
+}
+
+size_t
+winsock::tlsclient::recv(char* buf, size_t size)
+{
+  if (_plain.empty()) _plain = recv();
+  auto n = min(size, _plain.size());
+  CopyMemory(buf, _plain.data(), n);
+  _plain.remove_prefix(n);
+  return n;
 }
 
 size_t
@@ -308,16 +497,16 @@ winsock::tlsclient::send(char const* data, size_t size)
   assert(_ctx);
   if (!size) return size;
   size = min(size, _sizes.cbMaximumMessage);
-  std::vector<char> buf(_sizes.cbHeader + size + _sizes.cbTrailer);
+  _sbuf.resize(_sizes.cbHeader + _sizes.cbMaximumMessage + _sizes.cbTrailer);
   SecBuffer enc[4] = {
-    { _sizes.cbHeader, SECBUFFER_STREAM_HEADER, buf.data() },
+    { _sizes.cbHeader, SECBUFFER_STREAM_HEADER, _sbuf.data() },
     { DWORD(size), SECBUFFER_DATA, LPSTR(enc[0].pvBuffer) + enc[0].cbBuffer },
     { _sizes.cbTrailer, SECBUFFER_STREAM_TRAILER, LPSTR(enc[1].pvBuffer) + enc[1].cbBuffer }
   };
   SecBufferDesc encb { SECBUFFER_VERSION, 4, enc };
-  CopyMemory(buf.data() + _sizes.cbHeader, data, size);
+  CopyMemory(enc[1].pvBuffer, data, size);
   _ok(EncryptMessage(_ctx, 0, &encb, 0));
-  _send(buf.data(), enc[0].cbBuffer + enc[1].cbBuffer + enc[2].cbBuffer);
+  _send(_sbuf.data(), enc[0].cbBuffer + enc[1].cbBuffer + enc[2].cbBuffer);
   return size;
 }
 
@@ -327,8 +516,16 @@ winsock::tlsclient::send(char const* data, size_t size)
 std::string
 winsock::idn(std::string_view domain)
 {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::string> cache;
   for (auto c : domain) {
-    if (unsigned(c) >= 0x80) return idn(win32::wstring(domain));
+    if (unsigned(c) >= 0x80) {
+      std::string key(domain);
+      std::lock_guard<std::mutex> lock(mutex);
+      auto p = cache.find(key);
+      if (p == cache.end()) p = cache.emplace(key, idn(win32::wstring(domain))).first;
+      return p->second;
+    }
   }
   return std::string(domain);
 }
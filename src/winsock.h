@@ -6,8 +6,10 @@
  */
 #pragma once
 
+#include "netcache.h"
 #include <exception>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <winsock2.h>
@@ -21,9 +23,12 @@
 class winsock {
 public:
   winsock();
-  ~winsock() { WSACleanup(); }
+  ~winsock();
   static std::string idn(std::string_view domain);
   static std::string idn(std::wstring_view domain);
+  static std::shared_ptr<addrinfo> resolve(std::string const& host, std::string const& port, int domain = AF_UNSPEC);
+  static void prefetch(std::string const& host, std::string const& port, int domain = AF_UNSPEC);
+  static void forget(std::string const& host, std::string const& port, int domain = AF_UNSPEC);
 public:
   // tcpclient - TCP client socket
   class tcpclient {
@@ -38,7 +43,9 @@ public:
     tcpclient& operator=(tcpclient&& a) noexcept { return std::swap(_socket, a._socket), *this; }
     SOCKET release() noexcept { SOCKET s = _socket; _socket = INVALID_SOCKET; return s; }
     explicit operator bool() const noexcept { return _socket != INVALID_SOCKET; }
+    SOCKET handle() const noexcept { return _socket; }
     tcpclient& connect(std::string const& host, std::string const& port, int domain = AF_UNSPEC);
+    tcpclient& connect(struct addrinfo const* ai, std::string const& host = {});
     tcpclient& shutdown() noexcept;
     size_t recv(char* buf, size_t size);
     size_t send(char const* data, size_t size);
@@ -47,27 +54,39 @@ public:
 
   // tlsclient - transport layer security
   class tlsclient {
-    CredHandle _cred;
+    std::string _host;
     CtxtHandle _ctxb;
     CtxtHandle* _ctx = {};
     SecPkgContext_StreamSizes _sizes;
-    std::string _recvq;
-    size_t _rest = 0;
     std::vector<char> _rbuf;
-    size_t _remain = 0;
+    std::string_view _plain; // decrypted data in _rbuf.
+    size_t _extra = 0;       // position of the received data in _rbuf.
+    size_t _remain = 0;      // size of the received data.
+    bool _renegotiate = false; // the handshake after the plain data is taken.
+    std::vector<char> _sbuf;
     class error;
     SECURITY_STATUS _ok(SECURITY_STATUS ss) const;
     SECURITY_STATUS _init(SecBufferDesc* inb = {});
     void _send(char const* data, size_t size);
+    void _handshake();
+    void _rewind() noexcept;
+    void _renegotiation();
+    static CredHandle* _credential();
   public:
-    tlsclient();
-    virtual ~tlsclient();
+    tlsclient() {}
+    virtual ~tlsclient() { assert(!_ctx); }
     explicit operator bool() const noexcept { return _ctx != nullptr; }
-    tlsclient& connect();
+    tlsclient& connect(std::string const& host);
     tlsclient& shutdown() noexcept;
     bool verify(std::string const& cn, DWORD ignore = 0);
+    std::string_view recv();
     size_t recv(char* buf, size_t size);
     size_t send(char const* data, size_t size);
+    bool pending() const noexcept { return !_plain.empty() || _remain || _renegotiate; }
+  public:
+    // statistics - counts and elapsed times of the handshakes.
+    using statistics = handshakes::statistics;
+    static statistics stats();
   protected:
     virtual bool availlo() const noexcept = 0;
     virtual size_t recvlo(char* buf, size_t size) = 0;
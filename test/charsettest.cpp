@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+// charsettest - the tables of charmap.h against the converter of the
+// system, which is MultiByteToWideChar on Windows or iconv on the others.
+#include "test.h"
+#include "charset.h"
+#include <string>
+#if _WIN32
+#include <windows.h>
+#else
+#include <iconv.h>
+#endif
+
+namespace {
+#include "charmap.h"
+
+  // reference - the character by the system, or 0 if it's undefined.
+  unsigned
+  reference(unsigned codepage, std::string_view s)
+  {
+#if _WIN32
+    wchar_t w[2];
+    auto n = MultiByteToWideChar(codepage, MB_ERR_INVALID_CHARS, s.data(), int(s.size()), w, 2);
+    // the tables have no C1 controls, which Windows gives for the undefined.
+    if (n != 1 || (s.size() == 1 && w[0] >= 0x80 && w[0] <= 0x9f)) return 0;
+    return w[0];
+#else
+    std::string name;
+    switch (codepage) {
+    case 932: name = "CP932"; break;
+    case 1252: name = "CP1252"; break;
+    case 51932: name = "EUC-JP-MS"; break;
+    default: name = "ISO-8859-" + std::to_string(codepage - 28590); break;
+    }
+    static std::string last;
+    static iconv_t cd = iconv_t(-1);
+    if (name != last) {
+      if (cd != iconv_t(-1)) iconv_close(cd);
+      cd = iconv_open("UTF-32LE", name.c_str()), last = name;
+      if (cd == iconv_t(-1)) return 0;
+    }
+    char in[4], out[8];
+    s.copy(in, sizeof(in));
+    char* ip = in;
+    char* op = out;
+    size_t il = s.size(), ol = sizeof(out);
+    iconv(cd, {}, {}, {}, {});
+    if (iconv(cd, &ip, &il, &op, &ol) == size_t(-1) || il || op - out != 4) return 0;
+    return (out[0] & 255U) | (out[1] & 255U) << 8 | (out[2] & 255U) << 16 | (out[3] & 255U) << 24;
+#endif
+  }
+
+  // decoded - the character decoded by u8decode, or 0 if it's U+FFFD.
+  unsigned
+  decoded(unsigned codepage, std::string_view s)
+  {
+    std::string u;
+    unsigned long mode = 0;
+    if (!u8decode(codepage, s, u, mode) || u.empty()) return 0;
+    unsigned c = u[0] & 255;
+    auto n = c < 0x80 ? 0 : c < 0xe0 ? 1 : c < 0xf0 ? 2 : 3;
+    c &= 0x7f >> n;
+    for (size_t i = 1; i <= size_t(n) && i < u.size(); ++i) c = c << 6 | (u[i] & 0x3f);
+    return c == 0xfffd ? 0 : c;
+  }
+
+  // sjis - Shift_JIS of the row and the cell from 0.
+  std::string
+  sjis(unsigned row, unsigned cell)
+  {
+    char c = char(row / 2 + (row < 62 ? 0x81 : 0xc1));
+    char d = char(row & 1 ? cell + 0x9f : cell + (cell < 63 ? 0x40 : 0x41));
+    return { c, d };
+  }
+
+  bool
+  same(unsigned codepage, std::string_view s, unsigned table)
+  {
+    // only the characters defined by the system are compared, except
+    // the private use area which eucJP-ms gives for the rows 85-94.
+    auto ref = reference(codepage, s);
+    if (!ref || ref == table || (ref >= 0xe000 && ref <= 0xf8ff)) return true;
+    std::cerr << "  " << codepage << ":";
+    for (auto c : s) std::cerr << ' ' << std::hex << (c & 255);
+    std::cerr << ": U+" << table << " instead of U+" << ref << std::dec << std::endl;
+    return false;
+  }
+}
+
+/*
+ * Tests
+ */
+TEST(single_byte)
+{
+  for (auto const& t : sbcs) {
+    auto errors = 0, defined = 0;
+    for (unsigned c = 0x80; c < 0x100 && errors < 10; ++c) {
+      errors += !CHECK(same(t.codepage, std::string(1, char(c)), t.map[c - 0x80]));
+      defined += reference(t.codepage, std::string(1, char(c))) != 0;
+    }
+    if (!CHECK(defined > 32)) std::cerr << "  " << t.codepage << ": " << defined << " defined" << std::endl;
+  }
+}
+
+TEST(jis_x0208)
+{
+  // the rows of JIS X 0208 and the IBM extensions by Shift_JIS and EUC-JP.
+  auto errors = 0, defined = 0;
+  for (unsigned row = 0; row < 120 && errors < 10; ++row) {
+    if (row >= 94 && row < 114) continue; // the private use area.
+    for (unsigned cell = 0; cell < 94 && errors < 10; ++cell) {
+      auto const u = jis[row < 94 ? row : row - 20][cell];
+      errors += !CHECK(same(932, sjis(row, cell), u));
+      defined += reference(932, sjis(row, cell)) != 0;
+      errors += !CHECK(decoded(932, sjis(row, cell)) == u);
+      if (row < 94) {
+	std::string const euc { char(row + 0xa1), char(cell + 0xa1) };
+	errors += !CHECK(same(51932, euc, u));
+	errors += !CHECK(decoded(51932, euc) == u);
+      }
+    }
+  }
+  CHECK(defined > 7000);
+}
+
+TEST(carry_over)
+{
+  // the designation of ISO-2022-JP and a character split between the
+  // texts are carried over by the mode, and cleared with it.
+  std::string s;
+  unsigned long mode = 0;
+  CHECK(u8decode(50220, "\x1b$B0", s, mode) && s.empty() && mode);
+  CHECK(u8decode(50220, "!\x1b(B", s, mode) && s == "亜" && !mode);
+  CHECK(u8decode(50221, "\x1b$B", s, mode) && s.empty());
+  CHECK(u8decode(50221, "0!", s, mode) && s == "亜");
+  mode = 0;
+  CHECK(u8decode(50221, "0!", s, mode) && s == "0!");
+  CHECK(u8decode(932, "a\x88", s, mode) && s == "a" && mode);
+  CHECK(u8decode(932, "\x9f", s, mode) && s == "亜" && !mode);
+  CHECK(u8decode(51932, "\xb0", s, mode) && s.empty() && mode);
+  CHECK(u8decode(51932, "\xa1z", s, mode) && s == "亜z" && !mode);
+}
+
+TEST(os_converter)
+{
+  // US-ASCII drops the 8th bit, and EUC-JP of 20932 is left to the OS.
+  std::string s;
+  unsigned long mode = 0;
+  CHECK(u8decode(20127, "\xc1\x80z", s, mode) && s == std::string("A\0z", 3));
+  CHECK(u8decode(20932, "ascii", s, mode) && s == "ascii");
+  CHECK(!u8decode(20932, "\xa4\xa2", s, mode));
+}
+
+int main(int argc, char** argv) { return test::main(argc, argv); }
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#include "test.h"
+#include "executor.h"
+#include <chrono>
+
+namespace {
+  using namespace std::chrono_literals;
+
+  /** gate - the tasks are blocked until it's opened.
+   */
+  struct gate {
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool opened = false;
+    unsigned running = 0;
+    unsigned peak = 0;
+    unsigned done = 0;
+
+    void open() { std::lock_guard lock(mutex); opened = true; cond.notify_all(); }
+    template<class P> bool
+    until(P pred)
+    {
+      std::unique_lock lock(mutex);
+      return cond.wait_for(lock, 5s, pred);
+    }
+  };
+
+  struct task {
+    gate& g;
+    unsigned runs = 0;
+    void
+    run() noexcept
+    {
+      std::unique_lock lock(g.mutex);
+      ++runs, g.peak = std::max(g.peak, ++g.running);
+      g.cond.notify_all();
+      g.cond.wait(lock, [this] { return g.opened; });
+      --g.running, ++g.done;
+      g.cond.notify_all();
+    }
+  };
+
+  // settle - wait until the number of threads is n.
+  template<class T> bool
+  settle(executor<T>& ex, unsigned n)
+  {
+    for (auto i = 0; i < 500; ++i) {
+      if (ex.threads() == n) return true;
+      std::this_thread::sleep_for(10ms);
+    }
+    return false;
+  }
+}
+
+/*
+ * Tests
+ */
+TEST(bounded)
+{
+  // the tasks over the limit wait for the threads.
+  gate g;
+  std::deque<task> tasks;
+  executor<task> ex;
+  ex.limit(2);
+  for (auto i = 0; i < 5; ++i) ex.dispatch(&tasks.emplace_back(g));
+  CHECK(g.until([&g] { return g.running == 2; }));
+  CHECK(ex.threads() == 2);
+  g.open();
+  CHECK(g.until([&g] { return g.done == 5; }));
+  CHECK(g.peak == 2);
+  for (auto const& t : tasks) CHECK(t.runs == 1);
+  CHECK(ex.threads() == 2);
+}
+
+TEST(shrink)
+{
+  // the surplus threads end when the limit is lowered, both the busy
+  // ones after their tasks and the idle ones at once.
+  gate g;
+  std::deque<task> tasks;
+  executor<task> ex;
+  ex.limit(4);
+  for (auto i = 0; i < 4; ++i) ex.dispatch(&tasks.emplace_back(g));
+  CHECK(g.until([&g] { return g.running == 4; }));
+  ex.limit(1);
+  g.open();
+  CHECK(g.until([&g] { return g.done == 4; }));
+  CHECK(settle(ex, 1));
+  ex.limit(3);
+  for (auto i = 0; i < 3; ++i) ex.dispatch(&tasks.emplace_back(g));
+  CHECK(g.until([&g] { return g.done == 7; }));
+  CHECK(ex.threads() <= 3);
+  ex.limit(0); // it's at least 1.
+  CHECK(settle(ex, 1));
+  ex.dispatch(&tasks.emplace_back(g));
+  CHECK(g.until([&g] { return g.done == 8; }));
+}
+
+TEST(cancel)
+{
+  // only the tasks in the queue are canceled.
+  gate g;
+  task a { g }, b { g }, c { g };
+  executor<task> ex;
+  ex.limit(1);
+  ex.dispatch(&a);
+  CHECK(g.until([&g] { return g.running == 1; }));
+  ex.dispatch(&b);
+  ex.dispatch(&c);
+  CHECK(!ex.cancel(&a));
+  CHECK(ex.cancel(&b));
+  CHECK(!ex.cancel(&b));
+  g.open();
+  CHECK(g.until([&g] { return g.done == 2; }));
+  CHECK(a.runs == 1 && b.runs == 0 && c.runs == 1);
+}
+
+TEST(destructor)
+{
+  // the destructor waits for the running tasks, and drops the queue.
+  gate g;
+  task a { g }, b { g };
+  std::thread opener;
+  {
+    executor<task> ex;
+    ex.limit(1);
+    ex.dispatch(&a);
+    ex.dispatch(&b);
+    CHECK(g.until([&g] { return g.running == 1; }));
+    opener = std::thread([&g] { std::this_thread::sleep_for(100ms); g.open(); });
+  }
+  CHECK(a.runs == 1 && g.done == 1 && g.running == 0);
+  CHECK(b.runs == 0);
+  opener.join();
+}
+
+int main(int argc, char** argv) { return test::main(argc, argv); }
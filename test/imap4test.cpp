@@ -0,0 +1,746 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#include "test.h"
+#include "mock.h"
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+#if HAVE_POLLER
+#include "poller.h"
+#include <array>
+#include <deque>
+#include <fstream>
+#include <thread>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+  /** imapd - IMAP4 server of a mailbox in memory.
+   */
+  class imapd : public mock {
+    std::string _idletag;
+    bool _auth = false;
+    bool _qresync = false;
+    auto& _caps() const noexcept { return _auth && !authcaps.empty() ? authcaps : caps; }
+    static std::vector<std::pair<unsigned long, unsigned long>> _set(std::string_view set);
+    std::string _headers(size_t i) const;
+    void _fetch(std::string const& tag, std::string_view set);
+    void _changed(std::string const& tag, std::string_view arg);
+    void _compress();
+  protected:
+    void greet() override {
+      _auth = _qresync = false, silent = false;
+      reply("* OK IMAP4rev1 ready");
+    }
+    void line(std::string_view s) override;
+  public:
+    struct message {
+      unsigned long uid;
+      bool seen;
+      unsigned long long modseq;
+    };
+    std::vector<message> messages;
+    std::vector<std::pair<unsigned long, unsigned long long>> expunged; // UID and MODSEQ.
+    std::string caps = "IMAP4rev1 IDLE"; // capabilities before LOGIN.
+    std::string logincaps;               // capabilities in the LOGIN response.
+    std::string authcaps;                // capabilities after LOGIN if any.
+    unsigned long validity = 1;
+    unsigned long long modseq = 1;
+    size_t longest = 0; // the longest command line.
+    std::string subject = "message";
+    std::string before, after; // the items around UID and BODY of FETCH.
+    bool lowercase = false;    // the names of UID and BODY in lowercase.
+    bool silent = false; // no reply until the next connection.
+    bool idling() const noexcept { return !_idletag.empty(); }
+    void add(unsigned long first, unsigned long last, unsigned long step = 1);
+    void see(unsigned long uid);
+    void expunge(unsigned long uid);
+  };
+
+  /** box - mailbox fetched in the tests.
+   */
+  struct box : public mailbox {
+    unsigned fetched = 0;
+    box() : mailbox("test") { uripasswd("imap://user@localhost/", "secret"); }
+    void fetching(bool) override { ++fetched; }
+  };
+#if HAVE_POLLER
+
+  /** wakes - the sessions woken by the poller.
+   */
+  struct wakes {
+    std::mutex mutex;
+    std::condition_variable cond;
+    unsigned woken = 0;
+    unsigned ready = 0;
+
+    std::function<void(bool)>
+    fn()
+    {
+      return [this](bool r) { std::lock_guard lock(mutex); ++woken, ready += r; cond.notify_all(); };
+    }
+    bool
+    until(unsigned n, std::chrono::milliseconds ms)
+    {
+      std::unique_lock lock(mutex);
+      return cond.wait_for(lock, ms, [this, n] { return woken >= n; });
+    }
+  };
+
+  // status - the number of the item in /proc/self/status, such as VmRSS in kB.
+  long
+  status(std::string_view name)
+  {
+    std::ifstream in("/proc/self/status");
+    for (std::string ln; std::getline(in, ln);) {
+      if (ln.starts_with(name) && ln[name.size()] == ':') return strtol(ln.c_str() + name.size() + 1, {}, 10);
+    }
+    return -1;
+  }
+#endif
+}
+
+/*
+ * Functions of the class imapd
+ */
+std::vector<std::pair<unsigned long, unsigned long>>
+imapd::_set(std::string_view set)
+{
+  std::vector<std::pair<unsigned long, unsigned long>> ranges;
+  while (!set.empty()) {
+    auto i = set.find(',');
+    auto range = set.substr(0, i);
+    set.remove_prefix(i != set.npos ? i + 1 : set.size());
+    auto j = range.find(':');
+    auto first = strtoul(std::string(range.substr(0, j)).c_str(), {}, 10), last = first;
+    if (j != range.npos) {
+      auto s = range.substr(j + 1);
+      last = s == "*" ? ~0UL : strtoul(std::string(s).c_str(), {}, 10);
+    }
+    ranges.emplace_back(min(first, last), max(first, last));
+  }
+  return ranges;
+}
+
+std::string
+imapd::_headers(size_t i) const
+{
+  auto uid = std::to_string(messages[i].uid);
+  return ("Subject: " + subject + ' ' + uid + "\015\012"
+	  "From: Sender " + uid + " <sender" + uid + "@example.com>\015\012"
+	  "Date: Mon, 1 Feb 2021 12:34:56 +0900\015\012\015\012");
+}
+
+void
+imapd::_fetch(std::string const& tag, std::string_view set)
+{
+  // the messages are in the order of UIDs.
+  for (auto [first, last] : _set(set)) {
+    auto i = std::lower_bound(messages.cbegin(), messages.cend(), first,
+			      [](auto const& m, auto uid) { return m.uid < uid; }) - messages.cbegin();
+    for (; i < ptrdiff_t(messages.size()) && messages[i].uid <= last; ++i) {
+      auto headers = _headers(i);
+      raw("* " + std::to_string(i + 1) + " FETCH (" + before + (lowercase ? "uid " : "UID ") +
+	  std::to_string(messages[i].uid) +
+	  (lowercase ? " body[header.fields (subject from date)] {" : " BODY[HEADER.FIELDS (SUBJECT FROM DATE)] {") +
+	  std::to_string(headers.size()) + "}\015\012");
+      raw(headers);
+      reply(after + ")");
+    }
+  }
+  reply(tag + " OK FETCH completed");
+}
+
+void
+imapd::_changed(std::string const& tag, std::string_view arg)
+{
+  // UID FETCH 1:* (FLAGS) (CHANGEDSINCE <modseq> VANISHED)
+  auto since = strtoull(std::string(arg.substr(arg.find("CHANGEDSINCE ") + 13)).c_str(), {}, 10);
+  std::string set;
+  for (auto const& [uid, m] : expunged) {
+    if (m > since) set += (set.empty() ? "" : ",") + std::to_string(uid);
+  }
+  if (!set.empty()) reply("* VANISHED (EARLIER) " + set);
+  for (size_t i = 0; i < messages.size(); ++i) {
+    auto const& m = messages[i];
+    if (m.modseq <= since) continue;
+    reply("* " + std::to_string(i + 1) + " FETCH (UID " + std::to_string(m.uid) +
+	  " FLAGS (" + (m.seen ? "\\Seen" : "") + ") MODSEQ (" + std::to_string(m.modseq) + "))");
+  }
+  reply(tag + " OK FETCH completed");
+}
+
+void
+imapd::_compress()
+{
+#if HAVE_ZLIB
+  // raw DEFLATE by zlib, which is flushed at each reply.
+  std::shared_ptr<z_stream> in(new z_stream {}, [](auto z) { inflateEnd(z), delete z; });
+  std::shared_ptr<z_stream> out(new z_stream {}, [](auto z) { deflateEnd(z), delete z; });
+  inflateInit2(in.get(), -15);
+  deflateInit2(out.get(), Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+  auto filter = [](z_stream& z, std::string_view data, int (*f)(z_streamp, int)) {
+    std::string result;
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    z.avail_in = uInt(data.size());
+    char buf[4096];
+    do {
+      z.next_out = reinterpret_cast<Bytef*>(buf), z.avail_out = sizeof(buf);
+      f(&z, Z_SYNC_FLUSH);
+      result.append(buf, sizeof(buf) - z.avail_out);
+    } while (!z.avail_out);
+    return result;
+  };
+  decode = [=](std::string_view data) { return filter(*in, data, inflate); };
+  encode = [=](std::string_view data) { return filter(*out, data, deflate); };
+#endif
+}
+
+void
+imapd::line(std::string_view s)
+{
+  longest = max(longest, s.size());
+  if (silent) return;
+  if (idling()) {
+    if (s == "DONE") reply(std::exchange(_idletag, {}) + " OK IDLE terminated");
+    else reply("* BAD expected DONE");
+    return;
+  }
+  auto i = s.find(' ');
+  std::string const tag(s.substr(0, i));
+  auto const cmd = i != s.npos ? s.substr(i + 1) : std::string_view();
+  auto const ok = tag + " OK completed";
+  if (cmd == "CAPABILITY") {
+    reply("* CAPABILITY " + _caps());
+    reply(ok);
+  } else if (cmd.starts_with("LOGIN ")) {
+    _auth = true;
+    reply(tag + " OK " + (logincaps.empty() ? "" : "[CAPABILITY " + logincaps + "] ") + "logged in");
+  } else if (cmd == "ENABLE QRESYNC") {
+    _qresync = true;
+    reply("* ENABLED QRESYNC");
+    reply(ok);
+  } else if (cmd.starts_with("EXAMINE ")) {
+    reply("* " + std::to_string(messages.size()) + " EXISTS");
+    reply("* OK [UIDVALIDITY " + std::to_string(validity) + "] UIDs valid");
+    if (_caps().find("CONDSTORE") != _caps().npos || _caps().find("QRESYNC") != _caps().npos) {
+      reply("* OK [HIGHESTMODSEQ " + std::to_string(modseq) + "] highest");
+    }
+    reply(tag + " OK [READ-ONLY] EXAMINE completed");
+  } else if (cmd == "UID SEARCH UNSEEN" || cmd == "UID SEARCH ALL") {
+    std::string result = "* SEARCH";
+    for (auto const& m : messages) {
+      if (!m.seen || cmd.ends_with("ALL")) result += ' ' + std::to_string(m.uid);
+    }
+    reply(result);
+    reply(ok);
+  } else if (cmd.starts_with("UID FETCH 1:* (FLAGS) (CHANGEDSINCE ")) {
+    _changed(tag, cmd);
+  } else if (cmd.starts_with("UID FETCH ")) {
+    auto set = cmd.substr(10);
+    _fetch(tag, set.substr(0, set.find(' ')));
+  } else if (cmd.starts_with("FETCH ")) {
+    auto set = cmd.substr(6);
+    for (auto [first, last] : _set(set.substr(0, set.find(' ')))) {
+      for (auto n = first; n <= min(last, static_cast<unsigned long>(messages.size())); ++n) {
+	auto const& m = messages[n - 1];
+	reply("* " + std::to_string(n) + " FETCH (UID " + std::to_string(m.uid) +
+	      " FLAGS (" + (m.seen ? "\\Seen" : "") + "))");
+      }
+    }
+    reply(ok);
+  } else if (cmd == "COMPRESS DEFLATE" && _caps().find("COMPRESS=DEFLATE") != _caps().npos) {
+    reply(ok);
+    _compress();
+  } else if (cmd == "NOOP") {
+    reply(ok);
+  } else if (cmd == "IDLE") {
+    _idletag = tag;
+    reply("+ idling");
+  } else if (cmd == "LOGOUT") {
+    reply("* BYE logging out");
+    reply(ok);
+    close();
+  } else {
+    reply(tag + " BAD unknown command");
+  }
+}
+
+void
+imapd::add(unsigned long first, unsigned long last, unsigned long step)
+{
+  for (auto uid = first; uid <= last; uid += step) messages.push_back({ uid, false, ++modseq });
+  if (idling()) reply("* " + std::to_string(messages.size()) + " EXISTS");
+}
+
+void
+imapd::see(unsigned long uid)
+{
+  for (size_t i = 0; i < messages.size(); ++i) {
+    auto& m = messages[i];
+    if (m.uid != uid) continue;
+    m.seen = true, m.modseq = ++modseq;
+    if (idling()) {
+      reply("* " + std::to_string(i + 1) + " FETCH (FLAGS (\\Seen)" +
+	    (_qresync ? " UID " + std::to_string(uid) : "") + ")");
+    }
+  }
+}
+
+void
+imapd::expunge(unsigned long uid)
+{
+  for (size_t i = 0; i < messages.size(); ++i) {
+    if (messages[i].uid != uid) continue;
+    messages.erase(messages.begin() + i);
+    expunged.emplace_back(uid, ++modseq);
+    if (idling()) reply(_qresync ? "* VANISHED " + std::to_string(uid) : "* " + std::to_string(i + 1) + " EXPUNGE");
+    break;
+  }
+}
+
+/*
+ * Tests
+ */
+TEST(fetch_batched_sets)
+{
+  // the new UIDs are fetched by the sequence sets, not one by one.
+  imapd server;
+  server.listen();
+  server.add(1, 500);
+  server.add(1001, 4000, 3);
+  box mb;
+  mb.fetchmail();
+  CHECK(mb.recent() == 1500);
+  CHECK(mb.mails().size() == 1500);
+  auto uid = server.messages.cbegin();
+  for (auto const& m : mb.mails()) {
+    if (!CHECK(m.uid() == std::to_string((uid++)->uid))) break;
+  }
+  CHECK(mb.find("500") && mb.find("500")->subject() == "message 500");
+  auto batches = server.sent(" UID FETCH ");
+  CHECK(batches > 1 && batches < 10);
+  CHECK(server.longest < 1100);
+  // greeting, login, examine, search and the batches.
+  CHECK(server.roundtrips == 1 + 3 + 1 + 1 + batches);
+}
+
+TEST(fetch_known_mails)
+{
+  // the mails fetched before are not fetched again.
+  imapd server;
+  server.listen();
+  server.add(1, 100);
+  box mb;
+  mb.fetchmail();
+  CHECK(mb.recent() == 100);
+  server.add(101, 110);
+  server.see(5);
+  server.expunge(7);
+  mb.fetchmail();
+  CHECK(mb.recent() == 10);
+  CHECK(mb.mails().size() == 108);
+  CHECK(!mb.find("5") && !mb.find("7") && mb.find("110"));
+  CHECK(server.connections == 1);
+  CHECK(server.sent("UID FETCH 101:110 ") == 1);
+}
+
+TEST(fetch_items)
+{
+  // the nested lists, the quoted strings and the literals around the items
+  // are skipped, and the names of the items are case-insensitive.
+  imapd server;
+  server.listen();
+  server.add(1, 20);
+  server.subject = "(re: \"{3}] [x]";
+  server.before = "FLAGS (\\Seen (a (b) c)) X-QUOTED \"a \\\"(\\\\\" X-LITERAL {5}\015\012(\"{)\" ";
+  server.after = " ENVELOPE (NIL {3}\015\012)(( ((\"a\" NIL \"b\" \"c\")) NIL) MODSEQ (7)";
+  server.lowercase = true;
+  box mb;
+  mb.fetchmail();
+  CHECK(mb.recent() == 20);
+  CHECK(mb.find("20") && mb.find("20")->subject() == "(re: \"{3}] [x] 20");
+  server.before = "X-EMPTY {0}\015\012 X-LIST () ";
+  server.after = {};
+  server.add(21, 30);
+  mb.fetchmail();
+  CHECK(mb.recent() == 10 && mb.find("30"));
+}
+
+TEST(kept_session)
+{
+  // the kept session is probed in a short time, and logged out at last.
+  imapd server;
+  server.listen();
+  server.add(1, 10);
+  box mb;
+  mb.fetchmail();
+  mb.fetchmail();
+  CHECK(server.connections == 1);
+  CHECK(server.sent(" NOOP") == 1);
+  CHECK((server.timeouts == std::vector<int> { 60, 5, 60 }));
+  server.silent = true;
+  mb.fetchmail();
+  CHECK(server.connections == 2);
+  CHECK(mb.recent() == 0 && mb.mails().size() == 10);
+  mb.logout();
+  CHECK(server.received.back().ends_with(" LOGOUT"));
+  CHECK(server.closed());
+}
+
+TEST(kept_idling_session)
+{
+  // the idling session is resumed or logged out after finishing IDLE.
+  imapd server;
+  server.listen();
+  server.add(1, 10);
+  box mb;
+  mb.fetchmail(true);
+  CHECK(mb.parked().second > 0 && server.idling());
+  mb.keep();
+  server.add(11, 12);
+  mb.fetchmail(true);
+  CHECK(server.connections == 1 && server.sent("DONE") == 1 && !server.sent(" NOOP"));
+  CHECK(mb.recent() == 2 && mb.parked().second > 0 && server.idling());
+  mb.keep();
+  mb.logout();
+  CHECK(server.sent("DONE") == 2 && !server.idling());
+  CHECK(server.received.back().ends_with(" LOGOUT"));
+  CHECK(mb.parked().second == 0);
+}
+
+TEST(idling_rest)
+{
+  // a wake without the events parks the session again for the rest.
+  imapd server;
+  server.listen();
+  server.add(1, 10);
+  box mb;
+  mb.fetchmail(true);
+  auto const limit = mb.parked().second;
+  CHECK(limit > 0 && server.idling());
+  server.reply("* OK still here");
+  mb.fetchmail(true);
+  CHECK(!server.sent("DONE") && server.idling());
+  CHECK(mb.parked().second > 0 && mb.parked().second <= limit);
+  mb.logout();
+  CHECK(server.sent("DONE") == 1);
+}
+
+TEST(idling_changes)
+{
+  // the events while idling are applied to the map of UIDs without
+  // searching, and only the new UIDs are fetched.
+  imapd server;
+  server.listen();
+  server.add(1, 10);
+  box mb;
+  mb.fetchmail(true);
+  server.see(1);
+  mb.fetchmail(true); // the UIDs are mapped for the following IDLE.
+  CHECK(server.sent("UID SEARCH ALL") == 1 && mb.mails().size() == 9 && server.idling());
+  server.received.clear();
+  server.see(3);
+  server.expunge(5);
+  server.add(11, 13);
+  mb.fetchmail(true);
+  CHECK(!server.sent("SEARCH"));
+  CHECK(server.sent("UID FETCH") == 1 && server.sent("UID FETCH 11:13 ") == 1);
+  CHECK(mb.recent() == 3);
+  CHECK(mb.mails().size() == 10);
+  CHECK(!mb.find("3") && !mb.find("5") && mb.find("4") && mb.find("13"));
+  CHECK(mb.parked().second > 0 && server.idling());
+
+  // a UID which doesn't match the map falls back to searching.
+  server.received.clear();
+  server.reply("* 2 FETCH (UID 99 FLAGS ())");
+  mb.fetchmail(true);
+  CHECK(server.sent("UID SEARCH ALL") == 1 && server.sent("UID SEARCH UNSEEN") == 1);
+  CHECK(!server.sent("UID FETCH"));
+  CHECK(mb.recent() == 0 && mb.mails().size() == 10 && !mb.find("99"));
+  CHECK(mb.parked().second > 0 && server.idling());
+  mb.logout();
+}
+
+TEST(capability_after_login)
+{
+  // the capabilities are asked again if LOGIN doesn't tell them.
+  imapd server;
+  server.listen();
+  server.authcaps = "IMAP4rev1 ENABLE QRESYNC";
+  box mb;
+  mb.fetchmail(true);
+  CHECK(server.sent(" CAPABILITY") == 2);
+  CHECK(server.sent(" ENABLE QRESYNC") == 1);
+  CHECK(mb.parked().second == 0); // no IDLE after LOGIN.
+  server.logincaps = "IMAP4rev1 IDLE";
+  server.received.clear();
+  box mb2;
+  mb2.fetchmail(true);
+  CHECK(server.sent(" CAPABILITY") == 1);
+  CHECK(!server.sent(" ENABLE"));
+  CHECK(mb2.parked().second > 0);
+}
+
+TEST(qresync)
+{
+  // only the changes are fetched after the first fetch.
+  imapd server;
+  server.listen();
+  server.authcaps = "IMAP4rev1 ENABLE QRESYNC";
+  server.add(1, 3000);
+  box mb;
+  mb.fetchmail();
+  CHECK(mb.recent() == 3000);
+  for (unsigned long uid = 3000; uid > 0; uid -= 3) server.expunge(uid); // the ranges out of order.
+  for (unsigned long uid = 1; uid < 3000; uid += 3) server.see(uid);
+  server.add(3001, 3010);
+  server.received.clear();
+  mb.fetchmail();
+  CHECK(server.sent("CHANGEDSINCE") == 1);
+  CHECK(!server.sent("SEARCH"));
+  CHECK(mb.recent() == 10);
+  CHECK(mb.mails().size() == 1000 + 10);
+  for (auto const& m : mb.mails()) {
+    auto uid = strtoul(m.uid().c_str(), {}, 10);
+    if (!CHECK(uid > 3000 || uid % 3 == 2)) break;
+  }
+  server.validity = 2;
+  mb.fetchmail();
+  CHECK(server.sent("UID SEARCH UNSEEN") == 1);
+}
+
+TEST(tls_resumption)
+{
+  // a new connection resumes the TLS session, and the kept one needs no handshake.
+  imapd server;
+  server.listen();
+  server.add(1, 10);
+  box mb;
+  mb.uripasswd("imap+ssl://user@localhost/", "secret");
+  auto const before = winsock::tlsclient::stats();
+  mb.fetchmail();
+  mb.fetchmail();
+  auto s = winsock::tlsclient::stats();
+  CHECK(s.full == before.full + 1 && s.resumed == before.resumed);
+  mb.logout();
+  mb.fetchmail();
+  s = winsock::tlsclient::stats();
+  CHECK(s.full == before.full + 1 && s.resumed == before.resumed + 1);
+  mb.logout();
+  server.sessions.clear();
+  mb.fetchmail();
+  s = winsock::tlsclient::stats();
+  CHECK(s.full == before.full + 2 && s.resumed == before.resumed + 1);
+  CHECK(server.connections == 3 && mb.recent() == 0 && mb.mails().size() == 10);
+}
+
+#if HAVE_POLLER
+TEST(parked_wake)
+{
+  // an event wakes the session parked in the poller, and the canceled
+  // session is never woken.
+  using namespace std::chrono_literals;
+  imapd server;
+  server.listen();
+  server.add(1, 10);
+  box mb;
+  mb.fetchmail(true);
+  CHECK(mb.parked().second > 0 && server.idling());
+  wakes w;
+  poller p;
+  p.wait(&mb, mb.parked().first, mb.parked().second * 1000ULL, w.fn());
+  CHECK(!w.until(1, 50ms));
+  server.see(5);
+  CHECK(w.until(1, 5000ms) && w.ready == 1);
+  CHECK(p.cancel(&mb) == poller::DISPATCHED);
+  mb.fetchmail(true);
+  CHECK(!mb.find("5") && mb.mails().size() == 9);
+  CHECK(mb.parked().second > 0 && server.idling() && server.sent("DONE") == 1);
+  p.wait(&mb, mb.parked().first, mb.parked().second * 1000ULL, w.fn());
+  CHECK(p.cancel(&mb) == poller::CANCELED);
+  server.see(6);
+  CHECK(!w.until(2, 100ms));
+  CHECK(p.cancel(&mb) == poller::NONE);
+  mb.keep();
+  mb.logout();
+  CHECK(server.received.back().ends_with(" LOGOUT"));
+}
+#endif
+
+#if HAVE_ZLIB
+TEST(compress)
+{
+  // the responses are inflated after COMPRESS DEFLATE unless it's disabled.
+  imapd server;
+  server.listen();
+  server.caps += " COMPRESS=DEFLATE";
+  server.add(1, 300);
+  box mb;
+  mb.fetchmail();
+  CHECK(server.sent(" COMPRESS DEFLATE") == 1);
+  CHECK(mb.recent() == 300 && mb.find("300") && mb.find("300")->subject() == "message 300");
+  // the headers are compressed well, and the commands are stored as is.
+  auto const c = mb.compressed();
+  CHECK(c.received[0] > 0 && c.received[0] * 3 < c.received[1]);
+  CHECK(c.sent[1] > 0 && c.sent[0] > c.sent[1]);
+  mb.logout();
+  CHECK(server.received.back().ends_with(" LOGOUT"));
+  CHECK(mb.compressed().sent[1] > c.sent[1]);
+  box plain;
+  plain.compress(false);
+  plain.fetchmail();
+  CHECK(server.sent(" COMPRESS DEFLATE") == 1);
+  CHECK(plain.recent() == 300);
+  CHECK(plain.compressed().received[1] == 0 && plain.compressed().sent[1] == 0);
+}
+#endif
+
+/*
+ * Benchmarks
+ */
+BENCH(fetch_roundtrips)
+{
+  // the round trips of the first fetch, and the time at the latency of 40 ms.
+  for (auto n : { 1000UL, 5000UL, 20000UL }) {
+    imapd server;
+    server.listen();
+    server.add(1, n * 2, 2);
+    box mb;
+    mb.fetchmail();
+    std::cout << "  " << n << " unseen mails: " << server.roundtrips << " round trips, " <<
+      server.roundtrips * 0.04 << " s at 40 ms" << std::endl;
+  }
+}
+
+BENCH(tls_polls)
+{
+  // the round trips of a poll by a new TLS connection, and the time at 40 ms.
+  for (auto resume : { false, true }) {
+    imapd server;
+    server.listen();
+    server.add(1, 10);
+    box mb;
+    mb.uripasswd("imap+ssl://user@localhost/", "secret");
+    auto const before = winsock::tlsclient::stats();
+    for (auto i = 0; i < 100; ++i) {
+      if (!resume) server.sessions.clear();
+      mb.fetchmail();
+      mb.logout();
+    }
+    auto const s = winsock::tlsclient::stats();
+    auto const rt = server.roundtrips / 100.0;
+    std::cout << (resume ? "  resumed: " : "  full: ") << s.full - before.full << " full and " <<
+      s.resumed - before.resumed << " resumed handshakes, " << rt << " round trips/poll, " <<
+      rt * 0.04 << " s at 40 ms" << std::endl;
+  }
+}
+
+#if HAVE_POLLER
+BENCH(parked_sessions)
+{
+  // the threads and the memory of the IDLE sessions parked in the poller,
+  // against a thread per session blocked in reading the socket. The
+  // memory of the parked ones includes the mailboxes and the servers.
+  using namespace std::chrono;
+  for (auto n : { 100U, 500U, 1000U }) {
+    auto const rss = status("VmRSS");
+    std::deque<imapd> servers;
+    std::deque<box> boxes;
+    wakes w;
+    poller p;
+    for (unsigned i = 0; i < n; ++i) {
+      auto& server = servers.emplace_back();
+      server.listen();
+      server.add(1, 10);
+      auto& mb = boxes.emplace_back();
+      mb.fetchmail(true);
+      p.wait(&mb, mb.parked().first, mb.parked().second * 1000ULL, w.fn());
+    }
+    std::cout << "  " << n << " parked: " << status("Threads") << " threads, " <<
+      status("VmRSS") - rss << " kB";
+    auto const start = steady_clock::now();
+    for (auto& server : servers) server.see(1);
+    w.until(n, 10s);
+    std::cout << ", woken in " << duration_cast<microseconds>(steady_clock::now() - start).count() / 1000.0 <<
+      " ms" << std::endl;
+  }
+  for (auto n : { 100U, 500U, 1000U }) {
+    auto const rss = status("VmRSS");
+    std::vector<std::array<int, 2>> fds(n);
+    std::vector<std::thread> threads;
+    for (auto& fd : fds) {
+      socketpair(AF_UNIX, SOCK_STREAM, 0, fd.data());
+      threads.emplace_back([&fd] { pollfd pf { fd[0], POLLIN }; poll(&pf, 1, -1); });
+    }
+    std::this_thread::sleep_for(100ms);
+    std::cout << "  " << n << " threads: " << status("Threads") << " threads, " <<
+      status("VmRSS") - rss << " kB" << std::endl;
+    for (auto& fd : fds) CHECK(::write(fd[1], "x", 1) == 1);
+    for (auto& t : threads) t.join();
+    for (auto& fd : fds) ::close(fd[0]), ::close(fd[1]);
+  }
+}
+#endif
+
+BENCH(fetch_parse)
+{
+  // parsing the responses of 5000 new mails.
+  imapd server;
+  server.listen();
+  server.add(1, 10000, 2);
+  test::bench("  fetch 5000 mails", 20, [&server] {
+    box mb;
+    mb.fetchmail();
+  });
+  // with the other items such as Gmail gives.
+  server.before = "X-GM-THRID 1690000000000000000 X-GM-LABELS (\\Inbox \"a (b)\") ";
+  server.after = " FLAGS (\\Seen) ENVELOPE (\"Mon, 1 Feb 2021\" {7}\015\012subject"
+    " ((\"Sender\" NIL \"sender\" \"example.com\")) NIL NIL NIL NIL NIL NIL \"<id@example.com>\")";
+  test::bench("  fetch 5000 mails with more items", 20, [&server] {
+    box mb;
+    mb.fetchmail();
+  });
+  server.before = server.after = {};
+#if HAVE_ZLIB
+  // including the time of zlib in the mock, which flushes at each reply.
+  server.caps += " COMPRESS=DEFLATE";
+  test::bench("  fetch 5000 mails compressed", 20, [&server] {
+    box mb;
+    mb.fetchmail();
+  });
+  box mb;
+  mb.fetchmail();
+  auto const& c = mb.compressed();
+  std::cout << "  received " << c.received[0] << "/" << c.received[1] << " bytes, " <<
+    c.received[1] * 100 / c.received[0] / 100.0 << " times compressed" << std::endl;
+#endif
+}
+
+BENCH(qresync_vanished)
+{
+  // synchronizing 20000 mails after 10000 mails vanished.
+  imapd server;
+  server.listen();
+  server.authcaps = "IMAP4rev1 ENABLE QRESYNC";
+  server.add(1, 20000);
+  box mb;
+  mb.fetchmail();
+  auto const modseq = mb.modseq();
+  for (unsigned long uid = 1; uid <= 20000; uid += 2) server.expunge(uid);
+  test::bench("  sync with 10000 vanished ranges", 20, [&] {
+    maillist mails;
+    for (unsigned long uid = 1; uid <= 20000; ++uid) mails.push_back(mail(std::to_string(uid)));
+    mb.mails(mails);
+    mb.modseq(modseq.first, modseq.second);
+    mb.fetchmail();
+  });
+}
+
+int main(int argc, char** argv) { return test::main(argc, argv); }
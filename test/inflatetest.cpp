@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#include "test.h"
+#include "inflate.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <zlib.h>
+
+namespace {
+  std::mt19937 rng(1);
+
+  // deflate - raw DEFLATE by zlib, flushed at every flush bytes as IMAP.
+  std::string
+  deflate(std::string_view data, int level, int strategy = Z_DEFAULT_STRATEGY, size_t flush = 0,
+	  std::string_view dictionary = {})
+  {
+    z_stream z {};
+    deflateInit2(&z, level, Z_DEFLATED, -15, 8, strategy);
+    if (!dictionary.empty()) {
+      deflateSetDictionary(&z, reinterpret_cast<Bytef const*>(dictionary.data()), uInt(dictionary.size()));
+    }
+    std::string result;
+    char buf[4096];
+    if (!flush) flush = data.size();
+    do {
+      auto n = std::min(flush, data.size());
+      z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+      z.avail_in = uInt(n);
+      data.remove_prefix(n);
+      auto mode = data.empty() ? Z_FINISH : Z_SYNC_FLUSH;
+      do {
+	z.next_out = reinterpret_cast<Bytef*>(buf), z.avail_out = sizeof(buf);
+	::deflate(&z, mode);
+	result.append(buf, sizeof(buf) - z.avail_out);
+      } while (!z.avail_out);
+    } while (!data.empty());
+    deflateEnd(&z);
+    return result;
+  }
+
+  // inflate - decode the data given in the random pieces up to max bytes.
+  std::string
+  inflate(std::string_view data, size_t max)
+  {
+    inflater z;
+    std::string result;
+    while (!data.empty()) {
+      auto n = std::min(data.size(), size_t(rng() % max + 1));
+      result += z.inflate(data.substr(0, n));
+      data.remove_prefix(n);
+    }
+    return result;
+  }
+
+  std::string
+  text(size_t size)
+  {
+    // header lines of mails, which are compressed well.
+    std::string s;
+    for (unsigned i = 0; s.size() < size; ++i) {
+      s += "* " + std::to_string(i) + " FETCH (UID " + std::to_string(i * 3 + 1) +
+	" BODY[HEADER.FIELDS (SUBJECT FROM DATE)] {72}\015\012Subject: message " +
+	std::to_string(rng() % 100000) + "\015\012\015\012)\015\012";
+    }
+    return s.substr(0, size);
+  }
+
+  std::string
+  binary(size_t size)
+  {
+    std::string s(size, 0);
+    for (auto& c : s) c = char(rng());
+    return s;
+  }
+}
+
+/*
+ * Tests
+ */
+TEST(levels)
+{
+  // stored, fixed and dynamic blocks given in the pieces of any size.
+  for (auto size : { 0, 1, 100, 70000, 300000 }) {
+    auto const data = text(size);
+    for (auto level : { 0, 1, 6, 9 }) {
+      auto const z = deflate(data, level);
+      for (size_t max : { 1, 7, 1000, 65536 }) {
+	if (!CHECK(inflate(z, max) == data)) {
+	  std::cerr << "  size " << size << ", level " << level << ", pieces " << max << std::endl;
+	}
+      }
+    }
+  }
+}
+
+TEST(strategies)
+{
+  // the codes made by the other strategies.
+  auto const data = text(100000) + binary(20000) + std::string(50000, 'x');
+  for (auto strategy : { Z_FILTERED, Z_HUFFMAN_ONLY, Z_RLE, Z_FIXED }) {
+    auto const z = deflate(data, 9, strategy);
+    CHECK(inflate(z, 3000) == data);
+  }
+}
+
+TEST(sync_flush)
+{
+  // the responses of IMAP are flushed one by one.
+  auto const data = text(200000);
+  for (size_t flush : { 1, 60, 4096 }) {
+    auto const z = deflate(data, 6, Z_DEFAULT_STRATEGY, flush);
+    CHECK(inflate(z, 1460) == data);
+  }
+}
+
+TEST(errors)
+{
+  // the invalid block type, the broken stored block, and the distance
+  // to the dictionary which the inflater doesn't have.
+  std::string const data = text(1000);
+  for (auto const& bad : { std::string("\x07"), std::string("\x01\x05\x00\x00\x00", 5),
+			   deflate(data, 6, Z_DEFAULT_STRATEGY, 0, data) }) {
+    try {
+      inflater().inflate(bad);
+      CHECK(!"no error");
+    } catch (inflater::error const&) {
+    }
+  }
+}
+
+/*
+ * Benchmarks
+ */
+BENCH(inflate_1m)
+{
+  for (auto [name, data] : { std::pair("  1 MB text", text(1 << 20)), std::pair("  1 MB binary", binary(1 << 20)) }) {
+    auto const z = deflate(data, 6);
+    std::cout << name << ": " << z.size() << " bytes compressed" << std::endl;
+    test::bench(name, 20, [&z] {
+      inflater inf;
+      for (std::string_view s(z); !s.empty();) {
+	auto n = std::min(s.size(), size_t(16384));
+	inf.inflate(s.substr(0, n));
+	s.remove_prefix(n);
+      }
+    });
+  }
+}
+
+int main(int argc, char** argv) { return test::main(argc, argv); }
@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#include "test.h"
+#include "inifile.h"
+#include <fstream>
+#include <sstream>
+
+namespace {
+  /** tempfile - path of a temporary file removed at the end.
+   */
+  struct tempfile {
+    std::string path;
+    tempfile(std::string const& text = {}) {
+      path = (std::filesystem::temp_directory_path() / "befoo-inifiletest.ini").string();
+      std::filesystem::remove(path);
+      if (!text.empty()) std::ofstream(path, std::ios::binary) << text;
+    }
+    ~tempfile() { std::error_code ec; std::filesystem::remove(path, ec); }
+    std::string read() const {
+      std::ostringstream buf;
+      buf << std::ifstream(path, std::ios::binary).rdbuf();
+      return buf.str();
+    }
+  };
+
+  std::string
+  profile(size_t sections, size_t keys)
+  {
+    std::string s = "; befoo\r\n";
+    for (size_t i = 0; i < sections; ++i) {
+      s += "[mailbox" + std::to_string(i) + "]\r\n";
+      for (size_t k = 0; k < keys; ++k) {
+	s += "key" + std::to_string(k) + "=value " + std::to_string(i * keys + k) + "\r\n";
+      }
+      s += "\r\n";
+    }
+    return s;
+  }
+}
+
+/*
+ * Tests
+ */
+TEST(get_values)
+{
+  // values are trimmed, and the spaces in the quotes are kept.
+  inifile ini;
+  ini.parse("[Box]\r\n"
+	    "plain =  a b  \r\n"
+	    "dquoted=\"  a b  \"\r\n"
+	    "squoted=' x '\r\n"
+	    "unmatched=\"a'\r\n"
+	    "empty=\r\n"
+	    "; comment=no\r\n"
+	    "novalue\r\n");
+  CHECK(ini.get("Box", "plain") == "a b");
+  CHECK(ini.get("Box", "dquoted") == "  a b  ");
+  CHECK(ini.get("Box", "squoted") == " x ");
+  CHECK(ini.get("Box", "unmatched") == "\"a'");
+  CHECK(ini.get("Box", "empty").empty());
+  CHECK(ini.get("Box", "; comment").empty());
+  CHECK(ini.get("Box", "novalue").empty());
+  CHECK(ini.get("None", "plain").empty());
+}
+
+TEST(case_insensitive)
+{
+  // sections and keys are case-insensitive, and the first section wins.
+  inifile ini;
+  ini.parse("[Box]\r\nKey=1\r\n[BOX]\r\nkey=2\r\n");
+  CHECK(ini.get("box", "KEY") == "1");
+  ini.put("bOx", "kEy", "3");
+  CHECK(ini.get("Box", "Key") == "3");
+  CHECK(ini.keys("BOX").size() == 1 && ini.keys("BOX").front() == "Key");
+  CHECK(ini.sections().size() == 2);
+  ini.erase("box");
+  CHECK(ini.sections().empty());
+}
+
+TEST(text_kept)
+{
+  // comments, blank lines and the order are kept, and a new key is put
+  // before the trailing blank lines.
+  inifile ini;
+  ini.parse("; top\n[a]\n; note\nx = 1\n\n[b]\ny=2\n");
+  ini.put("a", "z", "3");
+  ini.put("a", "x", "4");
+  ini.put("c", "w", "5");
+  CHECK(ini.text() == "; top\r\n[a]\r\n; note\r\nx=4\r\nz=3\r\n\r\n[b]\r\ny=2\r\n[c]\r\nw=5\r\n");
+  ini.erase("a", "x");
+  ini.erase("b");
+  CHECK(ini.text() == "; top\r\n[a]\r\n; note\r\nz=3\r\n\r\n[c]\r\nw=5\r\n");
+  CHECK(ini.keys("a").size() == 1);
+}
+
+TEST(generation)
+{
+  // only the modifications make it dirty and count the generation.
+  inifile ini;
+  ini.parse("[a]\r\nx=1\r\n");
+  auto g = ini.generation();
+  ini.put("a", "x", "1");
+  ini.erase("a", "none");
+  ini.erase("none");
+  CHECK(ini.generation() == g);
+  ini.put("a", "x", "2");
+  CHECK(ini.generation() == g + 1 && ini.dirty());
+}
+
+TEST(flush_load)
+{
+  // the file is written only when dirty, and read again when changed.
+  tempfile f("[a]\r\nx=1\r\n");
+  {
+    inifile ini(f.path);
+    CHECK(ini.get("a", "x") == "1" && !ini.dirty());
+    CHECK(ini.flush());
+    ini.put("a", "y", "\" 2 \"");
+    CHECK(ini.flush() && !ini.dirty());
+    CHECK(f.read() == "[a]\r\nx=1\r\ny=\" 2 \"\r\n");
+    CHECK(!ini.refresh());
+  }
+  inifile ini(f.path);
+  CHECK(ini.get("a", "y") == " 2 ");
+  std::ofstream(f.path, std::ios::binary) << "[a]\r\nx=edited\r\n";
+  std::filesystem::last_write_time(f.path, std::filesystem::last_write_time(f.path) + std::chrono::seconds(2));
+  CHECK(ini.refresh());
+  CHECK(ini.get("a", "x") == "edited" && ini.get("a", "y").empty());
+}
+
+TEST(no_file)
+{
+  // an inifile without the file is kept in memory.
+  tempfile f;
+  inifile ini(f.path);
+  CHECK(!ini.load());
+  ini.put("a", "x", "1");
+  CHECK(ini.flush() && f.read() == "[a]\r\nx=1\r\n");
+  inifile mem;
+  mem.put("a", "x", "1");
+  CHECK(!mem.flush() && mem.dirty());
+}
+
+/*
+ * Benchmarks
+ */
+BENCH(parse)
+{
+  for (auto n : { 10U, 100U, 1000U }) {
+    auto const text = profile(n, 20);
+    test::bench("  " + std::to_string(n) + " sections of 20 keys", 20, [&] {
+      inifile ini;
+      ini.parse(text);
+    });
+  }
+}
+
+BENCH(get_put)
+{
+  // the settings of the mailboxes are taken at each fetch.
+  inifile ini;
+  ini.parse(profile(100, 20));
+  test::bench("  2000 gets", 100, [&] {
+    for (auto i = 0; i < 100; ++i) {
+      auto const s = "mailbox" + std::to_string(i);
+      for (auto k = 0; k < 20; ++k) ini.get(s, "key" + std::to_string(k));
+    }
+  });
+  test::bench("  2000 puts", 100, [&] {
+    for (auto i = 0; i < 100; ++i) {
+      auto const s = "mailbox" + std::to_string(i);
+      for (auto k = 0; k < 20; ++k) ini.put(s, "key" + std::to_string(k), std::to_string(i + k));
+    }
+  });
+}
+
+BENCH(flush)
+{
+  tempfile f(profile(100, 20));
+  inifile ini(f.path);
+  unsigned n = 0;
+  test::bench("  100 sections of 20 keys", 100, [&] {
+    ini.put("mailbox0", "key0", std::to_string(++n));
+    ini.flush();
+  });
+}
+
+int main(int argc, char** argv) { return test::main(argc, argv); }
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#include "test.h"
+#include "mock.h"
+
+namespace {
+  /** feeder - server sending the data at once.
+   */
+  class feeder : public mock {
+    std::string _data;
+  protected:
+    void greet() override { raw(_data); }
+    void line(std::string_view) override {}
+  public:
+    feeder(std::string const& data, size_t chunk = 0) : _data(data) { this->chunk = chunk, listen(); }
+  };
+
+  /** reader - backend to read the data from the feeder.
+   */
+  class reader : public mailbox::backend {
+  public:
+    reader() { tcp("localhost", "0", 0, 0); }
+    using backend::read;
+    using backend::readln;
+    bool login(uri const&, std::string const&) override { return false; }
+    void logout() override {}
+    size_t fetch(mailbox&, uri const&) override { return 0; }
+  };
+
+  std::string
+  lines(size_t n)
+  {
+    std::string s;
+    for (size_t i = 1; i <= n; ++i) {
+      s += "* " + std::to_string(i) + " FETCH (UID " + std::to_string(i) + " FLAGS (\\Seen))\015\012";
+    }
+    return s;
+  }
+}
+
+/*
+ * Tests
+ */
+TEST(readln_chunks)
+{
+  // the lines are the same however the data is split.
+  auto const data = lines(1000);
+  for (size_t chunk : { 0, 1, 2, 7, 4096, 16385 }) {
+    feeder server(data, chunk);
+    reader be;
+    size_t n = 0;
+    for (std::string_view s(data); !s.empty(); ++n) {
+      auto i = s.find("\015\012");
+      if (!CHECK(be.readln() == s.substr(0, i))) break;
+      s.remove_prefix(i + 2);
+    }
+    CHECK(n == 1000);
+    CHECK(!be.pending());
+  }
+}
+
+TEST(readln_separators)
+{
+  // only CRLF ends a line, and a line may be longer than the buffer.
+  std::string const longline(100000, 'x');
+  feeder server("a\012b\015c\015\012\015\012" + longline + "\015\012end\015\012", 5000);
+  reader be;
+  CHECK(be.readln() == "a\012b\015c");
+  CHECK(be.readln() == "");
+  CHECK(be.readln() == longline);
+  CHECK(be.readln() == "end");
+  try {
+    be.readln();
+    CHECK(!"timed out");
+  } catch (mailbox::silent const&) {
+  }
+}
+
+TEST(read_literal)
+{
+  // a literal is taken from the buffer, and the rest from the stream.
+  std::string literal;
+  for (int i = 0; i < 50000; ++i) literal += char('a' + i % 26);
+  for (size_t chunk : { 0, 3, 1000 }) {
+    feeder server("* 1 FETCH (BODY {50000}\015\012" + literal + ")\015\012* OK\015\012", chunk);
+    reader be;
+    CHECK(be.readln() == "* 1 FETCH (BODY {50000}");
+    CHECK(be.read(literal.size()) == literal);
+    CHECK(be.readln() == ")");
+    CHECK(be.read(0).empty());
+    CHECK(be.readln() == "* OK");
+  }
+}
+
+TEST(maillist_order)
+{
+  // the mails are kept in the order, and found by UID.
+  maillist mails;
+  for (auto uid : { "30", "10", "20" }) mails.push_back(mail(uid));
+  CHECK(mails.size() == 3);
+  std::string order;
+  for (auto const& m : mails) order += m.uid() + ' ';
+  CHECK(order == "30 10 20 ");
+  CHECK(mails.crbegin()->uid() == "20");
+  CHECK(mails.find("10") && mails.find("10")->uid() == "10");
+  CHECK(!mails.find("40"));
+  maillist other;
+  other.push_back(mail("40"));
+  mails.swap(other);
+  CHECK(mails.size() == 1 && mails.find("40") && !mails.find("10"));
+  CHECK(other.find("10"));
+}
+
+/*
+ * Benchmarks
+ */
+BENCH(readln_100k)
+{
+  auto const data = lines(100000);
+  std::cout << "  " << data.size() << " bytes" << std::endl;
+  for (size_t chunk : { 0, 1460 }) {
+    test::bench(chunk ? "  100k lines in 1460 bytes" : "  100k lines in 16 KB", 20, [&] {
+      feeder server(data, chunk);
+      reader be;
+      for (auto n = 100000; n--;) be.readln();
+    });
+  }
+}
+
+BENCH(read_literal_1m)
+{
+  auto const data = "* 1 FETCH (BODY {1000000}\015\012" + std::string(1000000, 'x') + ")\015\012";
+  test::bench("  1 MB literal", 100, [&] {
+    feeder server(data);
+    reader be;
+    be.readln();
+    be.read(1000000);
+    be.readln();
+  });
+}
+
+BENCH(maillist_find)
+{
+  // the mails known are looked up by the UIDs of SEARCH or UIDL.
+  for (auto n : { 1000, 10000, 100000 }) {
+    std::vector<std::string> uids;
+    for (auto i = 0; i < n; ++i) uids.push_back(std::to_string(i * 7 + 1));
+    maillist known;
+    for (auto const& uid : uids) known.push_back(mail(uid));
+    test::bench("  " + std::to_string(n) + " mails", 10, [&] {
+      maillist mails;
+      for (auto const& uid : uids) {
+	if (auto p = known.find(uid); p) mails.push_back(*p);
+      }
+    });
+  }
+}
+
+int main(int argc, char** argv) { return test::main(argc, argv); }
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#include "test.h"
+#include "mock.h"
+#include <random>
+
+namespace {
+  std::mt19937 rng(1);
+
+  /** decoder - mail::decoder with the decoding functions exposed.
+   */
+  struct decoder : public mail::decoder {
+    using mail::decoder::decoder;
+    using mail::decoder::decodeB;
+    using mail::decoder::decodeQ;
+  };
+
+  template<class F> bool
+  fails(F f)
+  {
+    try {
+      f();
+    } catch (int) {
+      return true;
+    }
+    return false;
+  }
+
+  std::string
+  encodeB(std::string_view s)
+  {
+    constexpr char b64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string result;
+    for (size_t i = 0; i < s.size(); i += 3) {
+      unsigned v = (s[i] & 255) << 16;
+      if (i + 1 < s.size()) v |= (s[i + 1] & 255) << 8;
+      if (i + 2 < s.size()) v |= s[i + 2] & 255;
+      result += b64[v >> 18];
+      result += b64[v >> 12 & 63];
+      result += i + 1 < s.size() ? b64[v >> 6 & 63] : '=';
+      result += i + 2 < s.size() ? b64[v & 63] : '=';
+    }
+    return result;
+  }
+
+  std::string
+  encodeQ(std::string_view s)
+  {
+    constexpr char hex[] = "0123456789ABCDEF";
+    std::string result;
+    for (auto c : s) {
+      if (c == ' ') result += '_';
+      else if (c < '!' || c > '~' || c == '=' || c == '?' || c == '_') {
+	result += '=', result += hex[c >> 4 & 15], result += hex[c & 15];
+      } else result += c;
+    }
+    return result;
+  }
+
+  time_t
+  date(std::string_view s)
+  {
+    return decoder(s).date();
+  }
+
+  std::string
+  headers(unsigned i)
+  {
+    // the headers which are seen in the mails of Japan and Europe.
+    auto const n = std::to_string(i);
+    return ("Subject: =?UTF-8?B?" + encodeB("日本語の件名 " + n) + "?=\015\012"
+	    " =?ISO-8859-1?Q?" + encodeQ("Gr\xfc\xdf" "e aus M\xfcnchen") + "?=\015\012"
+	    "From: =?UTF-8?B?" + encodeB("送信者") + "?= <sender" + n + "@example.com>\015\012"
+	    "Received: from mail.example.com by mx.example.com; Mon, 1 Feb 2021 12:34:56 +0900\015\012"
+	    "Date: Mon, 1 Feb 2021 12:34:56 +0900 (JST)\015\012\015\012");
+  }
+}
+
+/*
+ * Tests
+ */
+TEST(decode_b)
+{
+  // the padding only at the end, and the invalid characters are errors.
+  CHECK(decoder::decodeB("").empty());
+  CHECK(decoder::decodeB("QQ==") == "A");
+  CHECK(decoder::decodeB("QUI=") == "AB");
+  CHECK(decoder::decodeB("QUJD") == "ABC");
+  CHECK(decoder::decodeB("5pel5pys6Kqe") == "日本語");
+  for (auto bad : { "QUJ", "QU=D", "QQ==QUJD", "Q!==", "=QQQ", "Q===", "QUJD\015\012" }) {
+    if (!CHECK(fails([bad] { decoder::decodeB(bad); }))) std::cerr << "  " << bad << std::endl;
+  }
+  std::string all(256, '\0');
+  for (auto i = 0; i < 256; ++i) all[i] = char(i);
+  for (size_t n = 0; n <= all.size(); ++n) {
+    if (!CHECK(decoder::decodeB(encodeB(all.substr(0, n))) == all.substr(0, n))) break;
+  }
+}
+
+TEST(decode_q)
+{
+  // the underscores are spaces, and the hexadecimal digits are case-insensitive.
+  CHECK(decoder::decodeQ("a_b=20c") == "a b c");
+  CHECK(decoder::decodeQ("=E6=97=A5=e6=9c=ac") == "日本");
+  CHECK(decoder::decodeQ("=41") == "A");
+  for (auto bad : { "=", "=4", "ab=", "=G0", "=0g", "=\015\012" }) {
+    if (!CHECK(fails([bad] { decoder::decodeQ(bad); }))) std::cerr << "  " << bad << std::endl;
+  }
+  std::string s(1000, '\0');
+  for (auto& c : s) c = char(rng());
+  CHECK(decoder::decodeQ(encodeQ(s)) == s);
+}
+
+TEST(date_forms)
+{
+  // RFC 5322 and the obsolete forms, which don't depend on the time zone.
+  CHECK(date("Mon, 1 Feb 2021 12:34:56 +0900") == 1612150496);
+  CHECK(date("Mon, 1 Feb 2021 12:34:56 +0900 (JST)") == 1612150496);
+  CHECK(date("Mon ,\t01 feb 2021 12 : 34 : 56\t+0900") == 1612150496);
+  CHECK(date("1 Feb 21 12:34 EST") == 1612200840);
+  CHECK(date("1 Feb 2021 10:34 PDT") == 1612200840);
+  CHECK(date("Fri, 31 Dec 99 23:59:60 GMT") == 946684800);
+  CHECK(date("1 Jan 49 00:00 +0000") == 2493072000);
+  CHECK(date("1 Jan 50 00:00 UT") == -631152000);
+  CHECK(date("1 Jan 050 00:00 -0000") == -631152000);
+  CHECK(date("29 Feb 2000 21:00 +0900") == 951825600);
+  CHECK(date("1 Mar 2100 00:00:00 Z") == 4107542400);
+  for (auto bad : { "", "1 Feb 2021", "32 Feb 2021 00:00 +0000", "1 Foo 2021 00:00 +0000",
+		    "1 Feb 2021 24:00 +0000", "1 Feb 2021 12:60 +0000", "1 Feb 2021 12:34 +09",
+		    "1 Feb 20210 12:34 +0900", "123 Feb 2021 12:34 +0900", "1 Feb 2021 12:34 +0960" }) {
+    if (!CHECK(date(bad) == time_t(-1))) std::cerr << "  " << bad << std::endl;
+  }
+}
+
+TEST(fieldset)
+{
+  // the names are found without case, and the others aren't.
+  static constexpr mail::decoder::fieldset names {
+    "SUBJECT", "FROM", "DATE", "STATUS", "TO", "CC", "REPLY-TO", "MESSAGE-ID", "SENDER"
+  };
+  CHECK(names("Subject") == 0 && names("from") == 1 && names("DATE") == 2 && names("sTaTuS") == 3);
+  CHECK(names("to") == 4 && names("Cc") == 5 && names("Reply-To") == 6 && names("Message-ID") == 7);
+  CHECK(names("Sender") == 8);
+  for (auto other : { "", "X-Subject", "Subjects", "T", "Dare", "Received", "Sendex" }) {
+    if (!CHECK(names(other) < 0)) std::cerr << "  " << other << std::endl;
+  }
+}
+
+TEST(fields)
+{
+  // the fields are unfolded and trimmed, and the others are skipped.
+  static constexpr mail::decoder::fieldset names { "SUBJECT", "FROM" };
+  decoder de("Received: from a\015\012 by b\015\012"
+	     "Subject:  folded\015\012\tsubject \015\012"
+	     "no colon\015\012"
+	     "From:<a@example.com>");
+  auto [n, value] = de.field(names);
+  CHECK(n == 0 && value == "folded\tsubject");
+  std::tie(n, value) = de.field(names);
+  CHECK(n == 1 && value == "<a@example.com>");
+  CHECK(de.field(names).first < 0);
+}
+
+TEST(mail_header)
+{
+  // the encoded words of the subject and the sender.
+  mail m("1");
+  CHECK(!m.header(headers(1)));
+  CHECK(m.subject() == "日本語の件名 1Grüße aus München");
+  CHECK(m.sender() == "送信者");
+  CHECK(m.date() == 1612150496);
+  CHECK(m.header("Subject: =?UTF-8?Q?bad=?= x\015\012Status: RO\015\012"));
+  CHECK(m.subject() == "=?UTF-8?Q?bad=?= x");
+}
+
+/*
+ * Benchmarks
+ */
+BENCH(decode_words)
+{
+  std::string ja, eu;
+  for (auto i = 0; i < 10; ++i) {
+    ja += "日本語の件名です " + std::to_string(i);
+    eu += "Gr\xfc\xdf" "e aus M\xfcnchen, D\xfcsseldorf und K\xf6ln " + std::to_string(i);
+  }
+  auto const b = encodeB(ja), q = encodeQ(eu);
+  test::bench("  decodeB of " + std::to_string(b.size()) + " bytes", 10000, [&b] { decoder::decodeB(b); });
+  test::bench("  decodeQ of " + std::to_string(q.size()) + " bytes", 10000, [&q] { decoder::decodeQ(q); });
+}
+
+BENCH(date_parse)
+{
+  constexpr std::string_view dates[] = {
+    "Mon, 1 Feb 2021 12:34:56 +0900", "1 Feb 21 12:34 EST", "Tue, 02 Mar 2021 01:02:03 -0800 (PST)",
+  };
+  test::bench("  1000 dates", 1000, [&dates] {
+    for (auto i = 0; i < 1000; ++i) date(dates[i % 3]);
+  });
+}
+
+BENCH(header_parse)
+{
+  std::vector<std::string> hs;
+  for (unsigned i = 0; i < 1000; ++i) hs.push_back(headers(i));
+  test::bench("  1000 headers", 100, [&hs] {
+    mail m;
+    for (auto const& h : hs) m.header(h);
+  });
+}
+
+int main(int argc, char** argv) { return test::main(argc, argv); }
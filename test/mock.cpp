@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#include "mock.h"
+#include "charset.h"
+#if !_WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Functions of the class mock
+ */
+mock* mock::listening = {};
+
+mock::mock()
+{
+#if !_WIN32
+  socketpair(AF_UNIX, SOCK_STREAM, 0, _ready);
+#endif
+}
+
+mock::~mock()
+{
+  if (listening == this) listening = {};
+#if !_WIN32
+  for (auto fd : _ready) if (fd >= 0) ::close(fd);
+#endif
+}
+
+void
+mock::_accept()
+{
+  _in.clear(), _out.clear(), _pos = 0;
+  _sent = true, _closed = false;
+  decode = {}, encode = {};
+  ++connections;
+  greet();
+  _sync();
+}
+
+void
+mock::_receive(std::string_view data)
+{
+  _sent = true;
+  if (decode) _in += decode(data);
+  else _in += data;
+  for (size_t i; !_closed && (i = _in.find("\015\012")) != _in.npos;) {
+    std::string s = _in.substr(0, i);
+    _in.erase(0, i + 2);
+    received.push_back(s);
+    line(s);
+  }
+}
+
+size_t
+mock::_reply(char* buf, size_t size)
+{
+  if (std::exchange(_sent, false)) ++roundtrips;
+  if (_pos == _out.size()) {
+    if (_closed) return 0;
+    throw winsock::timedout();
+  }
+  auto n = min(size, _out.size() - _pos);
+  if (chunk) n = min(n, chunk);
+  CopyMemory(buf, _out.data() + _pos, n);
+  if ((_pos += n) == _out.size()) _out.clear(), _pos = 0;
+  _sync();
+  return n;
+}
+
+void
+mock::_sync() noexcept
+{
+#if !_WIN32
+  // a byte is left in the socket pair while the handle is readable.
+  auto readable = _closed || _pos < _out.size();
+  if (readable == _readable || _ready[0] < 0) return;
+  char c = 0;
+  if (readable ? ::write(_ready[1], &c, 1) == 1 : ::read(_ready[0], &c, 1) == 1) _readable = readable;
+#endif
+}
+
+void
+mock::reply(std::string_view s)
+{
+  raw(std::string(s) + "\015\012");
+}
+
+void
+mock::raw(std::string_view s)
+{
+  if (encode) _out += encode(s);
+  else _out += s;
+  _sync();
+}
+
+size_t
+mock::sent(std::string_view s) const
+{
+  size_t n = 0;
+  for (auto const& ln : received) n += ln.find(s) != ln.npos;
+  return n;
+}
+
+/*
+ * Functions of the class winsock::tcpclient
+ */
+winsock::tcpclient&
+winsock::tcpclient::connect(std::string const&, std::string const&, int)
+{
+  if (!mock::listening) throw error("connection refused");
+  _server = mock::listening;
+  _server->_accept();
+  return *this;
+}
+
+winsock::tcpclient&
+winsock::tcpclient::shutdown() noexcept
+{
+  if (_server) _server->close(), _server = {};
+  return *this;
+}
+
+SOCKET
+winsock::tcpclient::handle() const noexcept
+{
+#if !_WIN32
+  if (_server) return _server->_ready[0];
+#endif
+  return reinterpret_cast<SOCKET>(_server);
+}
+
+size_t
+winsock::tcpclient::recv(char* buf, size_t size)
+{
+  if (!_server) throw error("not connected");
+  return _server->_reply(buf, size);
+}
+
+size_t
+winsock::tcpclient::send(char const* data, size_t size)
+{
+  if (!_server || _server->_closed) throw error("disconnected");
+  _server->_receive({ data, size });
+  return size;
+}
+
+winsock::tcpclient&
+winsock::tcpclient::timeout(int sec)
+{
+  if (_server) _server->timeouts.push_back(sec);
+  return *this;
+}
+
+/*
+ * Functions of the class winsock::tlsclient
+ */
+namespace {
+  handshakes tlsstats;
+}
+
+winsock::tlsclient&
+winsock::tlsclient::connect(std::string const& host)
+{
+  // the full handshake takes two round trips, and the resumed one takes one.
+  auto server = mock::listening;
+  if (!server || server->closed()) throw error("not connected");
+  auto resumed = !server->sessions.insert(host).second;
+  server->roundtrips += resumed ? 1 : 2;
+  tlsstats.add(resumed, 0);
+  return *this;
+}
+
+winsock::tlsclient::statistics
+winsock::tlsclient::stats()
+{
+  return tlsstats.get();
+}
+
+std::string_view
+winsock::tlsclient::recv()
+{
+  if (_buf.empty()) _buf.resize(16 * 1024);
+  return { _buf.data(), recvlo(_buf.data(), _buf.size()) };
+}
+
+/*
+ * Functions of the class win32
+ */
+std::wstring
+win32::wstring(std::string_view s, UINT)
+{
+  // decode UTF-8 into UTF-16.
+  std::wstring ws;
+  for (size_t i = 0; i < s.size();) {
+    unsigned c = s[i++] & 255;
+    auto n = c < 0x80 ? 0 : c < 0xe0 ? 1 : c < 0xf0 ? 2 : 3;
+    c &= 0x7f >> n;
+    for (; n-- && i < s.size(); ++i) c = c << 6 | (s[i] & 0x3f);
+    if (c < 0x10000) {
+      ws += wchar_t(c);
+    } else {
+      ws += wchar_t(0xd800 + ((c - 0x10000) >> 10));
+      ws += wchar_t(0xdc00 + (c & 0x3ff));
+    }
+  }
+  return ws;
+}
+
+win32::u8conv&
+win32::u8conv::codepage(UINT codepage) noexcept
+{
+  if (codepage && codepage != _codepage) {
+    _codepage = codepage, _mode = 0;
+  }
+  return *this;
+}
+
+std::string
+win32::u8conv::operator()(std::string const& text)
+{
+  // the same as win32.cpp without the OS converter, which is tested by
+  // win32test on Windows.
+  if (!*this) throw text;
+  if (_codepage == CP_UTF8) return text;
+  if (std::string s; u8decode(_codepage, text, s, _mode)) return s;
+  throw text;
+}
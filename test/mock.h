@@ -0,0 +1,55 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#pragma once
+
+#include "stdafx.h"
+#include <functional>
+#include <unordered_set>
+
+/** mock - scripted server which the tcpclient connects to in process.
+ * The lines sent by the client are handled at once, and the replies are
+ * taken by the following recv(). A recv() after sending counts a round
+ * trip, and a recv() with no reply times out as a silent server does.
+ * The handle of the connection is readable while a reply is pending or
+ * after closed, so that the parked sessions can be polled on POSIX.
+ */
+class mock {
+  std::string _in, _out;
+  size_t _pos = 0;        // the position of _out not taken yet.
+  bool _sent = false;
+  bool _closed = true;
+  int _ready[2] = { -1, -1 }; // the socket pair of the handle.
+  bool _readable = false;
+  friend class winsock::tcpclient;
+  void _accept();
+  void _receive(std::string_view data);
+  size_t _reply(char* buf, size_t size);
+  void _sync() noexcept;
+protected:
+  virtual void greet() = 0;
+  virtual void line(std::string_view s) = 0;
+public:
+  static mock* listening; // the server accepting the next connection.
+  unsigned connections = 0;
+  unsigned roundtrips = 0;
+  size_t chunk = 0;       // the size limit of a reply, or 0 for no limit.
+  std::vector<int> timeouts; // the timeouts set by the client.
+  std::vector<std::string> received; // the lines sent by the client.
+  std::unordered_set<std::string> sessions; // the TLS sessions cached by the server.
+  // filters of the data, which are set when the stream is compressed.
+  std::function<std::string(std::string_view)> decode, encode;
+  mock();
+  virtual ~mock();
+  mock(mock const&) = delete;
+  void operator=(mock const&) = delete;
+  void listen() noexcept { listening = this; }
+  bool closed() const noexcept { return _closed; }
+  void close() noexcept { _closed = true, _sync(); }
+  void reply(std::string_view s);
+  void raw(std::string_view s);
+  size_t sent(std::string_view s) const; // the lines containing s.
+};
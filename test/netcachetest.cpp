@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+// netcachetest - the network state shared by the process, which is
+// apart from the sockets to be tested on any platform.
+#include "test.h"
+#include "netcache.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <stdexcept>
+
+namespace {
+  using namespace std::chrono_literals;
+  enum { V4 = 4, V6 = 6 };
+
+  /** resolver - resolvecache of the names by the fake lookup and clock.
+   * The lookup of "bad" fails, and the lookups are blocked while it's
+   * held.
+   */
+  struct resolver {
+    std::mutex mutex;
+    std::condition_variable cond;
+    unsigned long long now = 1000;
+    unsigned lookups = 0;
+    unsigned running = 0;
+    bool held = false;
+    resolvecache<std::string> cache {
+      [this](std::string const& host, std::string const& port, int domain) { return lookup(host, port, domain); },
+      [this] { std::lock_guard lock(mutex); return now; },
+      300, 30
+    };
+    std::string
+    lookup(std::string const& host, std::string const& port, int domain)
+    {
+      std::unique_lock lock(mutex);
+      ++lookups, ++running;
+      cond.notify_all();
+      cond.wait(lock, [this] { return !held; });
+      --running;
+      if (host == "bad") throw std::runtime_error("unknown host");
+      return host + ':' + port + '/' + std::to_string(domain) + '#' + std::to_string(lookups);
+    }
+    void elapse(unsigned long long ms) { std::lock_guard lock(mutex); now += ms; }
+    void hold(bool hold) { std::lock_guard lock(mutex); held = hold; cond.notify_all(); }
+    bool
+    until(unsigned n)
+    {
+      std::unique_lock lock(mutex);
+      return cond.wait_for(lock, 5s, [this, n] { return running == n; });
+    }
+    bool
+    fails(std::string const& host)
+    {
+      try {
+	cache.resolve(host, "143", 0);
+      } catch (std::runtime_error const&) {
+	return true;
+      }
+      return false;
+    }
+  };
+
+  /** addrs - the list of addresses like addrinfo.
+   */
+  struct addr {
+    int ai_family;
+    addr* ai_next;
+    int id;
+  };
+  struct addrs : public std::deque<addr> {
+    addrs(std::string_view families) {
+      for (auto c : families) push_back({ c == '6' ? V6 : V4, {}, int(size()) });
+      for (size_t i = 1; i < size(); ++i) (*this)[i - 1].ai_next = &(*this)[i];
+    }
+    addr const* head() const { return empty() ? nullptr : &front(); }
+  };
+
+  // ids - the order of the attempts by the ids.
+  template<class V> std::string
+  ids(V const& v)
+  {
+    std::string s;
+    for (auto p : v) s += char('0' + p->id);
+    return s;
+  }
+}
+
+/*
+ * Tests
+ */
+TEST(resolve_ttl)
+{
+  // the addresses are kept for the TTL, and resolved again after it.
+  resolver r;
+  CHECK(r.cache.resolve("a", "143", 0) == "a:143/0#1");
+  r.elapse(299);
+  CHECK(r.cache.resolve("a", "143", 0) == "a:143/0#1");
+  CHECK(r.cache.resolve("a", "993", 0) == "a:993/0#2");
+  CHECK(r.cache.resolve("a", "143", 6) == "a:143/6#3");
+  r.elapse(1);
+  CHECK(r.cache.resolve("a", "143", 0) == "a:143/0#4");
+  CHECK(r.lookups == 4);
+}
+
+TEST(resolve_negative)
+{
+  // the errors are kept for the shorter TTL.
+  resolver r;
+  CHECK(r.fails("bad") && r.lookups == 1);
+  r.elapse(29);
+  CHECK(r.fails("bad") && r.lookups == 1);
+  r.elapse(1);
+  CHECK(r.fails("bad") && r.lookups == 2);
+  CHECK(r.cache.resolve("a", "143", 0) == "a:143/0#3");
+}
+
+TEST(prefetch)
+{
+  // the prefetching is shared by the resolutions in progress.
+  resolver r;
+  r.hold(true);
+  CHECK(r.cache.prefetch("a", "143", 0));
+  CHECK(!r.cache.prefetch("a", "143", 0));
+  CHECK(r.until(1));
+  std::string result;
+  std::thread t([&r, &result] { result = r.cache.resolve("a", "143", 0); });
+  CHECK(!r.cache.prefetch("a", "143", 0));
+  std::this_thread::sleep_for(50ms);
+  CHECK(r.lookups == 1 && result.empty());
+  r.hold(false);
+  t.join();
+  CHECK(result == "a:143/0#1" && r.lookups == 1);
+  CHECK(!r.cache.prefetch("a", "143", 0));
+  r.elapse(300);
+  CHECK(r.cache.prefetch("a", "143", 0));
+  r.cache.join();
+  CHECK(r.cache.resolve("a", "143", 0) == "a:143/0#2" && r.lookups == 2);
+}
+
+TEST(prefetch_error)
+{
+  // the error of the prefetching is given to the resolution.
+  resolver r;
+  CHECK(r.cache.prefetch("bad", "143", 0));
+  r.cache.join();
+  CHECK(r.fails("bad") && r.lookups == 1);
+}
+
+TEST(forget)
+{
+  // the forgotten addresses are resolved again at once.
+  resolver r;
+  CHECK(r.cache.resolve("a", "143", 0) == "a:143/0#1");
+  CHECK(r.fails("bad"));
+  r.cache.forget("a", "143", 0);
+  r.cache.forget("bad", "143", 0);
+  r.cache.forget("unknown", "143", 0);
+  CHECK(r.cache.resolve("a", "143", 0) == "a:143/0#3");
+  CHECK(r.fails("bad") && r.lookups == 4);
+}
+
+TEST(verify_hit)
+{
+  // the chain isn't checked again for the same fingerprint.
+  unsigned long long now = 0;
+  verifycache cache([&now] { return now; }, 3600);
+  auto checks = 0;
+  auto ok = [&checks] { return ++checks, true; };
+  CHECK(cache.verify("example.com", 0, "fp1", ok) && checks == 1);
+  CHECK(cache.verify("example.com", 0, "fp1", ok) && checks == 1);
+  CHECK(cache.verify("example.net", 0, "fp1", ok) && checks == 2);
+  now = 3599;
+  CHECK(cache.verify("example.com", 0, "fp1", ok) && checks == 2);
+}
+
+TEST(verify_miss)
+{
+  // the TTL, the other fingerprint or level, and the failures miss.
+  unsigned long long now = 0;
+  verifycache cache([&now] { return now; }, 3600);
+  auto checks = 0;
+  auto ok = [&checks] { return ++checks, true; };
+  auto ng = [&checks] { return ++checks, false; };
+  CHECK(cache.verify("example.com", 0, "fp1", ok) && checks == 1);
+  now = 3600;
+  CHECK(cache.verify("example.com", 0, "fp1", ok) && checks == 2);
+  CHECK(cache.verify("example.com", 0x100, "fp1", ok) && checks == 3);
+  CHECK(cache.verify("example.com", 0x100, "fp1", ok) && checks == 3);
+  CHECK(!cache.verify("example.com", 0, "fp2", ng) && checks == 4);
+  CHECK(!cache.verify("example.com", 0, "fp1", ng) && checks == 5); // the changed one was dropped.
+  CHECK(cache.verify("example.com", 0, "", ok) && checks == 6);
+  CHECK(cache.verify("example.com", 0, "", ok) && checks == 7);
+  CHECK(!cache.verify("example.com", 0, "", ng) && checks == 8);
+}
+
+TEST(handshake_stats)
+{
+  // the full and the resumed handshakes are counted apart.
+  handshakes h;
+  h.add(false, 30);
+  h.add(true, 10);
+  h.add(true, 12);
+  auto s = h.get();
+  CHECK(s.full == 1 && s.fullms == 30 && s.resumed == 2 && s.resumedms == 22);
+  std::vector<std::thread> threads;
+  for (auto i = 0; i < 4; ++i) threads.emplace_back([&h] { for (auto n = 1000; n--;) h.add(n & 1, 1); });
+  for (auto& t : threads) t.join();
+  s = h.get();
+  CHECK(s.full == 2001 && s.resumed == 2002 && s.fullms + s.resumedms == 4052);
+}
+
+TEST(interleave)
+{
+  // the families take turns from the first one.
+  eyeballs e;
+  CHECK(ids(e.order(addrs("6664").head())) == "0312");
+  CHECK(ids(e.order(addrs("44666").head())) == "02134");
+  CHECK(ids(e.order(addrs("4646").head())) == "0123");
+  CHECK(ids(e.order(addrs("666").head())) == "012");
+  CHECK(e.order(addrs("").head()).empty());
+}
+
+TEST(preferred)
+{
+  // the family connected lastly to the host goes first.
+  eyeballs e;
+  addrs a("6644");
+  CHECK(ids(e.order(a.head(), "example.com")) == "0213");
+  e.connected("example.com", V4);
+  CHECK(ids(e.order(a.head(), "example.com")) == "2031");
+  CHECK(ids(e.order(a.head(), "example.net")) == "0213");
+  CHECK(ids(e.order(a.head())) == "0213");
+  e.connected("example.com", V6);
+  CHECK(ids(e.order(a.head(), "example.com")) == "0213");
+  e.connected({}, V4);
+  CHECK(ids(e.order(a.head())) == "0213");
+}
+
+TEST(pacing)
+{
+  // the next attempt starts after the delay, and all end at the timeout.
+  CHECK(eyeballs::wait(true, 0) == eyeballs::delay);
+  CHECK(eyeballs::wait(false, 0) == eyeballs::timeout);
+  CHECK(eyeballs::wait(false, 1000) == eyeballs::timeout - 1000);
+  CHECK(eyeballs::wait(true, eyeballs::timeout - 100) == 100);
+  CHECK(eyeballs::wait(false, eyeballs::timeout) == 0);
+  CHECK(eyeballs::wait(true, eyeballs::timeout + 1) == 0);
+
+  // the attempts to the silent addresses start every delay.
+  unsigned long long now = 0;
+  std::vector<unsigned long long> starts;
+  for (auto n = 4; n--;) {
+    starts.push_back(now);
+    now += eyeballs::wait(n > 0, now);
+  }
+  CHECK(starts == std::vector<unsigned long long>({ 0, 250, 500, 750 }));
+  CHECK(now == eyeballs::timeout && eyeballs::wait(false, now) == 0);
+}
+
+int main(int argc, char** argv) { return test::main(argc, argv); }
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#include "test.h"
+#include "stdafx.h"
+#include "poller.h"
+#include <atomic>
+#include <thread>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+  using namespace std::chrono_literals;
+
+  /** sockets - a socket pair, which is readable by put().
+   */
+  struct sockets {
+    int fd[2] = { -1, -1 };
+    sockets() { CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fd) == 0); }
+    ~sockets() { ::close(fd[0]), ::close(fd[1]); }
+    SOCKET socket() const noexcept { return fd[0]; }
+    void put() { CHECK(::write(fd[1], "x", 1) == 1); }
+  };
+
+  /** calls - the functions called by the poller.
+   */
+  struct calls {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<std::pair<int, bool>> called; // the id and readable.
+    bool blocked = false; // the functions wait until it's cleared.
+
+    std::function<void(bool)>
+    fn(int id)
+    {
+      return [this, id](bool ready) {
+	std::unique_lock lock(mutex);
+	called.emplace_back(id, ready);
+	cond.notify_all();
+	cond.wait(lock, [this] { return !blocked; });
+      };
+    }
+    bool
+    until(size_t n, std::chrono::milliseconds ms = 5000ms)
+    {
+      std::unique_lock lock(mutex);
+      return cond.wait_for(lock, ms, [this, n] { return called.size() >= n; });
+    }
+    void block(bool b) { std::lock_guard lock(mutex); blocked = b; cond.notify_all(); }
+  };
+}
+
+/*
+ * Tests
+ */
+TEST(readable)
+{
+  // the function is called once when the socket becomes readable.
+  sockets a;
+  calls c;
+  poller p;
+  p.wait(&a, a.socket(), 10000, c.fn(1));
+  CHECK(!c.until(1, 50ms));
+  a.put();
+  CHECK(c.until(1));
+  std::this_thread::sleep_for(50ms);
+  CHECK((c.called == std::vector<std::pair<int, bool>> { { 1, true } }));
+}
+
+TEST(expire)
+{
+  // the function is called with false when the time is expired.
+  sockets a;
+  calls c;
+  poller p;
+  auto const start = std::chrono::steady_clock::now();
+  p.wait(&a, a.socket(), 50, c.fn(1));
+  CHECK(c.until(1));
+  CHECK(std::chrono::steady_clock::now() - start >= 50ms);
+  CHECK((c.called == std::vector<std::pair<int, bool>> { { 1, false } }));
+  CHECK(p.cancel(&a) == poller::DISPATCHED);
+}
+
+TEST(cancel)
+{
+  // the canceled function is never called.
+  sockets a;
+  calls c;
+  poller p;
+  p.wait(&a, a.socket(), 10000, c.fn(1));
+  CHECK(p.cancel(&a) == poller::CANCELED);
+  a.put();
+  CHECK(!c.until(1, 100ms));
+  CHECK(p.cancel(&a) == poller::NONE);
+  CHECK(p.cancel(&c) == poller::NONE);
+}
+
+TEST(dispatched)
+{
+  // cancel() waits for the function being called, and tells it.
+  sockets a;
+  calls c;
+  poller p;
+  c.block(true);
+  p.wait(&a, a.socket(), 10000, c.fn(1));
+  a.put();
+  CHECK(c.until(1));
+  std::atomic<bool> returned = false;
+  std::thread canceler([&] { CHECK(p.cancel(&a) == poller::DISPATCHED); returned = true; });
+  std::this_thread::sleep_for(50ms);
+  CHECK(!returned);
+  c.block(false);
+  canceler.join();
+  CHECK(returned);
+  CHECK(p.cancel(&a) == poller::NONE);
+}
+
+TEST(signal)
+{
+  // the thread waiting for the others is woken up by the new sockets.
+  sockets a, b, d;
+  calls c;
+  poller p;
+  p.wait(&a, a.socket(), 60000, c.fn(1));
+  std::this_thread::sleep_for(20ms); // the thread is polling a.
+  auto const start = std::chrono::steady_clock::now();
+  p.wait(&b, b.socket(), 50, c.fn(2));
+  CHECK(c.until(1, 2000ms) && c.called[0] == std::make_pair(2, false));
+  p.wait(&d, d.socket(), 60000, c.fn(3));
+  d.put();
+  CHECK(c.until(2, 2000ms) && c.called[1] == std::make_pair(3, true));
+  CHECK(std::chrono::steady_clock::now() - start < 2000ms);
+  // the function of the same key is replaced.
+  p.wait(&a, a.socket(), 50, c.fn(4));
+  CHECK(c.until(3, 2000ms) && c.called[2] == std::make_pair(4, false));
+  CHECK(!c.until(4, 50ms));
+}
+
+TEST(destructor)
+{
+  // the waiting functions are dropped by the destructor.
+  sockets a;
+  calls c;
+  {
+    poller p;
+    p.wait(&a, a.socket(), 60000, c.fn(1));
+  }
+  a.put();
+  CHECK(!c.until(1, 50ms));
+}
+
+int main(int argc, char** argv) { return test::main(argc, argv); }
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#include "test.h"
+#include "mock.h"
+
+namespace {
+  /** pop3d - POP3 server of a maildrop in memory.
+   */
+  class pop3d : public mock {
+  protected:
+    void greet() override { reply("+OK POP3 ready"); }
+    void line(std::string_view s) override;
+  public:
+    struct message {
+      std::string uid;
+      bool read;
+    };
+    std::vector<message> messages;
+    std::string capa = "USER UIDL TOP";
+    void add(unsigned first, unsigned last, bool read = false);
+  };
+
+  /** box - mailbox fetched in the tests.
+   */
+  struct box : public mailbox {
+    box() : mailbox("test") { uripasswd("pop://user@localhost/", "secret"); }
+    void fetching(bool) override {}
+  };
+}
+
+/*
+ * Functions of the class pop3d
+ */
+void
+pop3d::line(std::string_view s)
+{
+  if (s == "CAPA") {
+    reply("+OK capability list follows");
+    for (auto i = capa.find_first_not_of(' '); i != capa.npos;) {
+      auto j = capa.find(' ', i);
+      reply(capa.substr(i, j - i));
+      i = capa.find_first_not_of(' ', j);
+    }
+    reply(".");
+  } else if (s.starts_with("USER ") || s.starts_with("PASS ")) {
+    reply("+OK");
+  } else if (s == "UIDL") {
+    reply("+OK unique-id listing follows");
+    for (size_t i = 0; i < messages.size(); ++i) {
+      reply(std::to_string(i + 1) + ' ' + messages[i].uid);
+    }
+    reply(".");
+  } else if (s.starts_with("TOP ") && s.ends_with(" 0")) {
+    auto n = strtoul(std::string(s.substr(4)).c_str(), {}, 10);
+    if (n < 1 || n > messages.size()) return reply("-ERR no such message");
+    auto const& m = messages[n - 1];
+    reply("+OK top of message follows");
+    reply("Subject: message " + m.uid);
+    reply("From: <sender@example.com>");
+    reply("Date: Mon, 1 Feb 2021 12:34:56 +0900");
+    if (m.read) reply("Status: RO");
+    reply("");
+    reply(".");
+  } else if (s == "QUIT") {
+    reply("+OK bye");
+    close();
+  } else {
+    reply("-ERR unknown command");
+  }
+}
+
+void
+pop3d::add(unsigned first, unsigned last, bool read)
+{
+  for (auto n = first; n <= last; ++n) messages.push_back({ "uid" + std::to_string(n), read });
+}
+
+/*
+ * Tests
+ */
+TEST(pipelining)
+{
+  // the commands are sent in the batches with PIPELINING.
+  pop3d server;
+  server.listen();
+  server.capa += " PIPELINING";
+  server.add(1, 200);
+  box mb;
+  mb.fetchmail();
+  CHECK(mb.recent() == 200);
+  CHECK(mb.find("uid1") && mb.find("uid1")->subject() == "message uid1");
+  CHECK(mb.mails().crbegin()->uid() == "uid200");
+  // greeting, CAPA, USER and PASS, UIDL, 4 batches of TOP and QUIT.
+  CHECK(server.roundtrips == 1 + 1 + 1 + 1 + 4 + 1);
+  CHECK(server.closed());
+}
+
+TEST(no_pipelining)
+{
+  // a command at once without PIPELINING.
+  pop3d server;
+  server.listen();
+  server.add(1, 20);
+  box mb;
+  mb.fetchmail();
+  CHECK(mb.recent() == 20);
+  CHECK(server.roundtrips == 1 + 1 + 2 + 1 + 20 + 1);
+}
+
+TEST(uidl_diff)
+{
+  // only the new messages are taken by TOP, and the read ones are ignored.
+  pop3d server;
+  server.listen();
+  server.capa += " PIPELINING";
+  server.add(1, 10);
+  server.add(11, 12, true);
+  box mb;
+  mb.fetchmail();
+  CHECK(mb.recent() == 10);
+  CHECK(mb.ignore().size() == 2 && mb.ignore().contains("uid11"));
+  server.messages.erase(server.messages.begin()); // uid1 deleted.
+  server.add(13, 15);
+  server.received.clear();
+  mb.fetchmail();
+  CHECK(server.sent("TOP ") == 3);
+  CHECK(mb.recent() == 3);
+  CHECK(mb.mails().size() == 12);
+  CHECK(!mb.find("uid1") && mb.find("uid15") && !mb.find("uid11"));
+  CHECK(mb.ignore().size() == 2);
+}
+
+/*
+ * Benchmarks
+ */
+BENCH(pipelining_roundtrips)
+{
+  // the round trips of the first fetch, and the time at the latency of 40 ms.
+  for (auto pipelining : { false, true }) {
+    for (auto n : { 100U, 1000U, 5000U }) {
+      pop3d server;
+      server.listen();
+      if (pipelining) server.capa += " PIPELINING";
+      server.add(1, n);
+      box mb;
+      mb.fetchmail();
+      std::cout << "  " << n << " new messages" << (pipelining ? " with PIPELINING: " : ": ") <<
+	server.roundtrips << " round trips, " << server.roundtrips * 0.04 << " s at 40 ms" << std::endl;
+    }
+  }
+}
+
+int main(int argc, char** argv) { return test::main(argc, argv); }
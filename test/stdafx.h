@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+// stdafx.h for the tests - the sources under test are compiled with this
+// instead of src/stdafx.h. The Windows API they use is replaced by the
+// small portable parts below, and the sockets by the mock servers.
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "netcache.h"
+
+using std::min;
+using std::max;
+
+typedef unsigned char BYTE;
+typedef unsigned long DWORD;
+typedef unsigned UINT;
+typedef uintptr_t SOCKET;
+#define INVALID_SOCKET (~SOCKET(0))
+#define CP_UTF8 65001
+#define SECURITY_FLAG_IGNORE_REVOCATION 0x0080
+#define SECURITY_FLAG_IGNORE_UNKNOWN_CA 0x0100
+#define SECURITY_FLAG_IGNORE_WRONG_USAGE 0x0200
+#define SECURITY_FLAG_IGNORE_CERT_DATE_INVALID 0x2000
+#define CopyMemory memcpy
+#define MoveMemory memmove
+inline bool IsDBCSLeadByte(BYTE) noexcept { return false; }
+
+class mock;
+
+struct winsock {
+  class error : public std::exception {
+    std::string _msg;
+  public:
+    error(std::string const& msg = "winsock error") : _msg(msg) {}
+    char const* what() const noexcept override { return _msg.c_str(); }
+  };
+  class timedout : public error {
+  public:
+    timedout() : error("timed out") {}
+  };
+  static void prefetch(std::string const&, std::string const&, int = 0) {}
+
+  // tcpclient - a connection to mock::listening.
+  class tcpclient {
+    mock* _server = {};
+  public:
+    tcpclient() {}
+    ~tcpclient() { shutdown(); }
+    tcpclient& operator=(SOCKET s) noexcept { return _server = reinterpret_cast<mock*>(s), *this; }
+    explicit operator bool() const noexcept { return _server != nullptr; }
+    tcpclient& connect(std::string const& host, std::string const& port, int domain = 0);
+    tcpclient& shutdown() noexcept;
+    SOCKET release() noexcept { return reinterpret_cast<SOCKET>(std::exchange(_server, {})); }
+    SOCKET handle() const noexcept; // the socket pair of the mock on POSIX.
+    size_t recv(char* buf, size_t size);
+    size_t send(char const* data, size_t size);
+    tcpclient& timeout(int sec);
+  };
+
+  // tlsclient - no encryption, so the mock servers speak in plain.
+  // Only the handshakes are counted, and the sessions cached by the
+  // server are resumed.
+  class tlsclient {
+    std::string _buf;
+  public:
+    virtual ~tlsclient() {}
+    tlsclient& connect(std::string const& host);
+    tlsclient& shutdown() noexcept { return *this; }
+    bool verify(std::string const&, DWORD = 0) { return true; }
+    size_t recv(char* buf, size_t size) { return recvlo(buf, size); }
+    std::string_view recv();
+    size_t send(char const* data, size_t size) { return sendlo(data, size); }
+    bool pending() const noexcept { return false; }
+    using statistics = handshakes::statistics;
+    static statistics stats();
+    virtual bool availlo() const noexcept = 0;
+    virtual size_t recvlo(char* buf, size_t size) = 0;
+    virtual size_t sendlo(char const* data, size_t size) = 0;
+  };
+};
+
+struct win32 {
+  static std::wstring wstring(std::string_view s, UINT codepage = CP_UTF8);
+  static std::string time(time_t) { return {}; }
+
+  // u8conv - UTF-8 converter only by the built-in decoders.
+  class u8conv {
+    UINT _codepage = 0;
+    unsigned long _mode = 0;
+  public:
+    u8conv& codepage(UINT codepage) noexcept;
+    u8conv& reset() noexcept { _mode = 0; return *this; }
+    explicit operator bool() const noexcept { return _codepage != 0; }
+    std::string operator()(std::string const& text);
+  };
+};
+
+#define DBG(s)
+#define LOG(s)
+
+#include "mailbox.h"
@@ -0,0 +1,77 @@
+/* -*- mode: c++ -*-
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#pragma once
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+/** test - minimal checks and benchmarks.
+ * A test program runs the checks registered by TEST, or the benchmarks
+ * registered by BENCH when it's given "bench" as the argument.
+ */
+namespace test {
+  struct entry {
+    char const* name;
+    void (*f)();
+  };
+  inline std::vector<entry>& tests() { static std::vector<entry> v; return v; }
+  inline std::vector<entry>& benches() { static std::vector<entry> v; return v; }
+  inline int failures = 0;
+
+  struct registrar {
+    registrar(std::vector<entry>& v, char const* name, void (*f)()) { v.push_back({ name, f }); }
+  };
+
+  inline bool
+  check(bool ok, char const* expr, char const* file, int line)
+  {
+    if (!ok) ++failures, std::cerr << file << "(" << line << "): failed: " << expr << std::endl;
+    return ok;
+  }
+
+  // bench - run f for n times, and print the time per call.
+  template<class F> void
+  bench(std::string_view name, unsigned n, F f)
+  {
+    using namespace std::chrono;
+    f(); // warm up.
+    auto const t = steady_clock::now();
+    for (auto i = n; i--;) f();
+    auto const ns = duration_cast<nanoseconds>(steady_clock::now() - t).count();
+    std::cout << name << ": " << double(ns) / n / 1000 << " us/op (" << n << " ops)" << std::endl;
+  }
+
+  inline int
+  main(int argc, char** argv)
+  {
+    auto const bench = argc > 1 && !std::strcmp(argv[1], "bench");
+    for (auto const& e : bench ? benches() : tests()) {
+      std::cout << e.name << std::endl;
+      try {
+	e.f();
+      } catch (std::exception const& ex) {
+	++failures, std::cerr << e.name << ": exception: " << ex.what() << std::endl;
+      } catch (...) {
+	++failures, std::cerr << e.name << ": unknown exception" << std::endl;
+      }
+    }
+    if (failures) std::cerr << failures << " failure(s)" << std::endl;
+    return failures != 0;
+  }
+}
+
+#define TEST_ENTRY(list, name)						\
+  static void name();							\
+  static test::registrar name##_registrar(test::list(), #name, name);	\
+  static void name()
+#define TEST(name) TEST_ENTRY(tests, name)
+#define BENCH(name) TEST_ENTRY(benches, name)
+#define CHECK(e) test::check(static_cast<bool>(e), #e, __FILE__, __LINE__)
@@ -0,0 +1,166 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+#include "test.h"
+#include "uidjournal.h"
+
+namespace {
+  using uids = std::unordered_set<std::string>;
+
+  /** journal - uidjournal stored in a string instead of a file.
+   */
+  struct journal : public uidjournal {
+    std::string file;
+    bool available = true;
+    unsigned appended = 0;
+    unsigned replaced = 0;
+    journal(std::string_view name = "test") : uidjournal(name, "imap://user@localhost/") {}
+    bool _available() const noexcept override { return available; }
+    void
+    _append(size_t pos, std::string const& data) override
+    {
+      CHECK(pos <= file.size());
+      file.resize(pos), file += data, ++appended;
+    }
+    void _replace(std::string const& data) override { file = data, ++replaced; }
+    bool load(std::string_view data) { return _parse(data); }
+  };
+
+  // loaded - UIDs of the journal loaded from the file.
+  uids
+  loaded(std::string_view file, bool* ok = {})
+  {
+    journal j;
+    auto result = j.load(file);
+    if (ok) *ok = result;
+    return j.uids();
+  }
+
+  uids
+  range(unsigned first, unsigned last)
+  {
+    uids u;
+    for (auto i = first; i <= last; ++i) u.insert(std::to_string(i));
+    return u;
+  }
+}
+
+/*
+ * Tests
+ */
+TEST(round_trip)
+{
+  // the first update writes the whole, and the others append the records.
+  journal j;
+  CHECK(!j);
+  j.update(range(1, 3));
+  CHECK(j && j.replaced == 1 && j.appended == 0);
+  CHECK(loaded(j.file) == range(1, 3));
+  j.update(range(2, 5));
+  CHECK(j.replaced == 1 && j.appended == 1);
+  CHECK(loaded(j.file) == range(2, 5));
+  j.update(range(2, 5));
+  CHECK(j.appended == 1);
+
+  // the loaded journal continues the file.
+  journal k;
+  CHECK(k.load(j.file) && k && k.uids() == range(2, 5));
+  k.file = j.file;
+  k.update(range(4, 6));
+  CHECK(k.replaced == 0 && k.appended == 1);
+  CHECK(loaded(k.file) == range(4, 6));
+}
+
+TEST(foreign)
+{
+  // the journals of the other mailboxes and versions are not loaded.
+  journal j;
+  j.update(range(1, 3));
+  bool ok;
+  CHECK(loaded(j.file, &ok) == range(1, 3) && ok);
+  journal other("other");
+  CHECK(other.hash() != j.hash());
+  CHECK(!other.load(j.file) && !other);
+  auto v2 = j.file;
+  v2[4] = '\x02';
+  CHECK(loaded(v2, &ok).empty() && !ok);
+  CHECK(loaded(j.file.substr(0, 12), &ok).empty() && !ok);
+}
+
+TEST(truncated)
+{
+  // a torn record at the end is ignored, and overwritten by the next.
+  journal j;
+  j.update(range(1, 3));
+  j.update(range(1, 4));
+  auto const whole = j.file;
+  for (auto n = whole.size() - 3; n < whole.size(); ++n) {
+    bool ok;
+    if (!CHECK(loaded(whole.substr(0, n), &ok) == range(1, 3) && ok)) std::cerr << "  " << n << std::endl;
+  }
+  for (auto garbage : { "+", "+\x05" "ab", "-\x80", "x1" }) {
+    journal k;
+    k.file = whole + garbage;
+    CHECK(k.load(k.file) && k.uids() == range(1, 4));
+    k.update(range(1, 5));
+    CHECK(k.file.starts_with(whole) && loaded(k.file) == range(1, 5));
+    CHECK(k.file.size() == whole.size() + 3);
+  }
+}
+
+TEST(compaction)
+{
+  // the obsolete records are dropped when they exceed the slack.
+  journal j;
+  j.update(range(1, 10));
+  for (unsigned i = 11; j.replaced == 1; ++i) {
+    if (!CHECK(i < 100)) break;
+    j.update(range(i - 9, i));
+  }
+  journal compact;
+  compact.update(j.uids());
+  CHECK(j.file.size() == compact.file.size() && loaded(j.file) == j.uids());
+  auto const replaced = j.replaced;
+  j.compact();
+  CHECK(j.replaced == replaced);
+  j.update(range(1, 5));
+  CHECK(j.replaced == replaced && j.appended > 0);
+  j.compact();
+  CHECK(j.replaced == replaced + 1);
+  CHECK(loaded(j.file) == range(1, 5));
+  j.compact();
+  CHECK(j.replaced == replaced + 1);
+}
+
+TEST(long_uids)
+{
+  // the length of the UID takes more bytes over 127.
+  journal j;
+  uids u { std::string(127, 'a'), std::string(128, 'b'), std::string(300, 'c'), std::string(70000, 'd') };
+  j.update(u);
+  CHECK(loaded(j.file) == u);
+  CHECK(j.file.find(std::string("+\x7f") + std::string(127, 'a')) != std::string::npos);
+  CHECK(j.file.find(std::string("+\x80\x01") + std::string(128, 'b')) != std::string::npos);
+  CHECK(j.file.find(std::string("+\xac\x02") + std::string(300, 'c')) != std::string::npos);
+  CHECK(j.file.find(std::string("+\xf0\xa2\x04") + 'd') != std::string::npos);
+  u.insert("e");
+  j.update(u);
+  CHECK(j.appended == 1 && loaded(j.file) == u);
+  bool ok;
+  CHECK(loaded(j.file.substr(0, j.file.size() - 1), &ok).size() == 4 && ok);
+}
+
+TEST(unavailable)
+{
+  // nothing is written without the storage.
+  journal j;
+  j.available = false;
+  j.update(range(1, 3));
+  j.compact();
+  CHECK(!j && j.file.empty() && j.appended == 0 && j.replaced == 0);
+}
+
+int main(int argc, char** argv) { return test::main(argc, argv); }
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+// win32test - the UTF-8 converter with the converters of Windows, so this
+// is built with src/stdafx.h instead of the replacement in this directory.
+#include "../src/stdafx.h"
+#include "test.h"
+
+namespace {
+  template<class F> bool
+  fails(F f)
+  {
+    try {
+      f();
+    } catch (std::string const&) {
+      return true;
+    }
+    return false;
+  }
+}
+
+/*
+ * Tests
+ */
+TEST(u8conv_builtin)
+{
+  // the built-in decoders carry the mode over between the texts.
+  win32::u8conv conv;
+  CHECK(!conv && fails([&conv] { conv("text"); }));
+  conv.codepage(50220);
+  CHECK(conv && conv("\x1b$B0").empty());
+  CHECK(conv("!\x1b(B") == "亜");
+  CHECK(conv("\x1b$B").empty() && conv("0!") == "亜");
+  CHECK(conv.reset()("0!") == "0!");
+  conv.codepage(932);
+  CHECK(conv("a\x88") == "a" && conv("\x9f") == "亜");
+  CHECK(conv.codepage(65001)("\xe6\x97\xa5") == "\xe6\x97\xa5");
+}
+
+TEST(u8conv_os)
+{
+  // the others are converted by mlang or MultiByteToWideChar.
+  win32::u8conv conv;
+  conv.codepage(949);
+  CHECK(conv("ascii") == "ascii");
+  CHECK(conv("\xb0\xa1") == "가");
+  conv.codepage(1251);
+  CHECK(conv("\xcf\xf0\xe8") == "При");
+  conv.codepage(20932);
+  CHECK(conv("\xb0\xa1") == "亜");
+}
+
+int main(int argc, char** argv) { return test::main(argc, argv); }
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2009-2021 TSUBAKIMOTO Hiroya <z0rac@users.sourceforge.jp>
+ *
+ * This software comes with ABSOLUTELY NO WARRANTY; for details of
+ * the license terms, see the LICENSE.txt file included with the program.
+ */
+// winsocktest - the real sockets on Windows, so this is built with
+// src/stdafx.h instead of the replacement in this directory.
+#include "../src/stdafx.h"
+#include "test.h"
+#include <thread>
+
+namespace {
+  winsock wsa;
+
+  /** listener - TCP server listening on the loopback.
+   */
+  class listener {
+    SOCKET _socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  public:
+    sockaddr_in addr { AF_INET };
+    listener() {
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      int len = sizeof(addr);
+      if (_socket == INVALID_SOCKET ||
+	  bind(_socket, LPSOCKADDR(&addr), len) == SOCKET_ERROR ||
+	  getsockname(_socket, LPSOCKADDR(&addr), &len) == SOCKET_ERROR ||
+	  listen(_socket, SOMAXCONN) == SOCKET_ERROR) throw winsock::error();
+    }
+    ~listener() { close(); }
+    SOCKET handle() const noexcept { return _socket; }
+    SOCKET accept() { return ::accept(_socket, {}, {}); }
+    void close() noexcept { if (_socket != INVALID_SOCKET) closesocket(std::exchange(_socket, INVALID_SOCKET)); }
+  };
+
+  /** tlsd - TLS 1.2 server by Schannel, which only handshakes.
+   * The sessions are cached by Schannel, so the clients can resume them.
+   */
+  class tlsd : public listener {
+    CredHandle _cred;
+    std::thread _thread;
+    static PCCERT_CONTEXT _certificate();
+    void _handshake(SOCKET s) noexcept;
+  public:
+    tlsd();
+    ~tlsd() { close(), _thread.join(), FreeCredentialsHandle(&_cred); }
+  };
+
+  /** tlsclient - TLS client on a TCP connection.
+   */
+  class tlsclient : public winsock::tlsclient {
+    winsock::tcpclient _tcp;
+    bool availlo() const noexcept override { return bool(_tcp); }
+    size_t recvlo(char* buf, size_t size) override { return _tcp.recv(buf, size); }
+    size_t sendlo(char const* data, size_t size) override { return _tcp.send(data, size); }
+  public:
+    tlsclient(struct addrinfo const* ai) { _tcp.connect(ai); }
+    ~tlsclient() { shutdown(); }
+  };
+
+  /** addresses - addrinfo list built in place.
+   */
+  struct addresses {
+    std::list<sockaddr_in> addrs;
+    std::vector<struct addrinfo> ai;
+    addresses(std::initializer_list<sockaddr_in> list) : addrs(list), ai(list.size()) {
+      auto p = addrs.begin();
+      for (size_t i = 0; i < ai.size(); ++i, ++p) {
+	ai[i] = { 0, AF_INET, SOCK_STREAM, IPPROTO_TCP, sizeof(*p), {}, LPSOCKADDR(&*p) };
+	if (i) ai[i - 1].ai_next = &ai[i];
+      }
+    }
+    operator struct addrinfo const*() const noexcept { return ai.data(); }
+  };
+
+  sockaddr_in
+  blackhole(sockaddr_in const& addr)
+  {
+    // TEST-NET-1 (RFC 5737) never answers.
+    auto result = addr;
+    inet_pton(AF_INET, "192.0.2.1", &result.sin_addr);
+    return result;
+  }
+}
+
+/*
+ * Functions of the class tlsd
+ */
+PCCERT_CONTEXT
+tlsd::_certificate()
+{
+  // a self-signed certificate of localhost with the key in a container.
+  static struct certificate {
+    PCCERT_CONTEXT context;
+    certificate() {
+      constexpr auto container = "befoo-test";
+      HCRYPTPROV prov;
+      HCRYPTKEY key;
+      if (!CryptAcquireContext(&prov, container, MS_ENH_RSA_AES_PROV, PROV_RSA_AES, CRYPT_NEWKEYSET) &&
+	  !CryptAcquireContext(&prov, container, MS_ENH_RSA_AES_PROV, PROV_RSA_AES, 0)) throw win32::error();
+      auto ok = CryptGenKey(prov, AT_KEYEXCHANGE, 2048 << 16, &key);
+      if (ok) CryptDestroyKey(key);
+      CryptReleaseContext(prov, 0);
+      win32::valid(ok);
+      BYTE name[256];
+      DWORD size = sizeof(name);
+      win32::valid(CertStrToName(X509_ASN_ENCODING, "CN=localhost", CERT_X500_NAME_STR, {}, name, &size, {}));
+      CERT_NAME_BLOB subject { size, name };
+      CRYPT_KEY_PROV_INFO info { const_cast<LPWSTR>(L"befoo-test"), const_cast<LPWSTR>(MS_ENH_RSA_AES_PROV_W),
+				 PROV_RSA_AES, 0, 0, {}, AT_KEYEXCHANGE };
+      context = win32::valid(CertCreateSelfSignCertificate({}, &subject, 0, &info, {}, {}, {}, {}));
+    }
+    ~certificate() {
+      CertFreeCertificateContext(context);
+      HCRYPTPROV prov;
+      CryptAcquireContext(&prov, "befoo-test", MS_ENH_RSA_AES_PROV, PROV_RSA_AES, CRYPT_DELETEKEYSET);
+    }
+  } cert;
+  return cert.context;
+}
+
+tlsd::tlsd()
+{
+  SEC_CHAR pkg[] = UNISP_NAME;
+  auto cert = _certificate();
+  SCHANNEL_CRED auth { SCHANNEL_CRED_VERSION, 1, &cert };
+  auth.grbitEnabledProtocols = SP_PROT_TLS1_2_SERVER; // the sessions by IDs.
+  if (auto ss = AcquireCredentialsHandle({}, pkg, SECPKG_CRED_INBOUND, {}, &auth, {}, {}, &_cred, {}); FAILED(ss)) {
+    throw winsock::error("SSPI error #0x" + win32::hexdigit(ss));
+  }
+  _thread = std::thread([this, ls = handle()] {
+    for (SOCKET s; (s = ::accept(ls, {}, {})) != INVALID_SOCKET;) {
+      _handshake(s);
+      for (char t[256]; ::recv(s, t, sizeof(t), 0) > 0;) continue; // until the client closes.
+      closesocket(s);
+    }
+  });
+}
+
+void
+tlsd::_handshake(SOCKET s) noexcept
+{
+  constexpr ULONG req = ASC_REQ_STREAM | ASC_REQ_ALLOCATE_MEMORY | ASC_REQ_CONFIDENTIALITY;
+  CtxtHandle ctx;
+  CtxtHandle* pctx = {};
+  std::vector<char> buf(16 * 1024);
+  size_t n = 0;
+  for (SECURITY_STATUS ss = SEC_E_INCOMPLETE_MESSAGE;;) {
+    if (ss == SEC_E_INCOMPLETE_MESSAGE || !n) {
+      auto t = ::recv(s, buf.data() + n, int(buf.size() - n), 0);
+      if (t <= 0) break;
+      n += t;
+    }
+    SecBuffer in[2] { { DWORD(n), SECBUFFER_TOKEN, buf.data() }, { 0, SECBUFFER_EMPTY } };
+    SecBuffer out { 0, SECBUFFER_TOKEN };
+    SecBufferDesc inb { SECBUFFER_VERSION, 2, in }, outb { SECBUFFER_VERSION, 1, &out };
+    ULONG attr;
+    ss = AcceptSecurityContext(&_cred, pctx, &inb, req, 0, &ctx, &outb, &attr, {});
+    if (ss == SEC_E_INCOMPLETE_MESSAGE) continue;
+    pctx = &ctx;
+    if (out.pvBuffer) {
+      ::send(s, LPCSTR(out.pvBuffer), int(out.cbBuffer), 0);
+      FreeContextBuffer(out.pvBuffer);
+    }
+    if (in[1].BufferType == SECBUFFER_EXTRA) {
+      MoveMemory(buf.data(), buf.data() + n - in[1].cbBuffer, in[1].cbBuffer);
+      n = in[1].cbBuffer;
+    } else {
+      n = 0;
+    }
+    if (ss != SEC_I_CONTINUE_NEEDED) break;
+  }
+  if (pctx) DeleteSecurityContext(pctx);
+}
+
+/*
+ * Tests
+ */
+TEST(connect_fallback)
+{
+  // the next address is tried after the delay while the first one hangs.
+  listener server;
+  addresses ai { blackhole(server.addr), server.addr };
+  auto start = GetTickCount64();
+  winsock::tcpclient client;
+  client.connect(ai);
+  auto elapse = GetTickCount64() - start;
+  CHECK(client);
+  CHECK(elapse < 5000);
+  auto s = server.accept();
+  CHECK(s != INVALID_SOCKET);
+  client.send("ok", 2);
+  char buf[2];
+  CHECK(recv(s, buf, 2, 0) == 2 && buf[0] == 'o');
+  closesocket(s);
+}
+
+TEST(connect_loopback)
+{
+  // the first address is taken without waiting for the delay.
+  listener server;
+  addresses ai { server.addr, blackhole(server.addr) };
+  auto start = GetTickCount64();
+  winsock::tcpclient client;
+  client.connect(ai);
+  CHECK(client && GetTickCount64() - start < 250);
+}
+
+TEST(tls_resumption)
+{
+  // the session of the first handshake is resumed by the followings.
+  tlsd server;
+  addresses ai { server.addr };
+  auto const before = winsock::tlsclient::stats();
+  for (auto i = 0; i < 3; ++i) {
+    tlsclient client(ai);
+    client.connect("localhost");
+    CHECK(client);
+  }
+  auto const after = winsock::tlsclient::stats();
+  CHECK(after.full + after.resumed == before.full + before.resumed + 3);
+  CHECK(after.resumed >= before.resumed + 2);
+}
+
+TEST(connect_refused)
+{
+  // an error is thrown when no address accepts.
+  sockaddr_in addr;
+  {
+    listener closed;
+    addr = closed.addr;
+  }
+  addresses ai { addr };
+  winsock::tcpclient client;
+  try {
+    client.connect(ai);
+    CHECK(!"connected");
+  } catch (winsock::error const&) {
+  }
+  CHECK(!client);
+}
+
+/*
+ * Benchmarks
+ */
+BENCH(connect)
+{
+  listener server;
+  addresses loopback { server.addr };
+  addresses fallback { blackhole(server.addr), server.addr };
+  for (auto [name, ai] : { std::pair("  loopback", &loopback), std::pair("  behind a blackhole", &fallback) }) {
+    test::bench(name, 10, [&] {
+      winsock::tcpclient client;
+      client.connect(*ai);
+      closesocket(server.accept());
+    });
+  }
+}
+
+BENCH(tls_handshake)
+{
+  // the average times of the full and the resumed handshakes.
+  tlsd server;
+  addresses ai { server.addr };
+  auto const before = winsock::tlsclient::stats();
+  for (auto i = 0; i < 50; ++i) {
+    tlsclient client(ai);
+    client.connect("localhost");
+  }
+  auto const after = winsock::tlsclient::stats();
+  auto full = after.full - before.full, resumed = after.resumed - before.resumed;
+  std::cout << "  full: " << full << " handshakes, " <<
+    (full ? double(after.fullms - before.fullms) / full : 0) << " ms/op" << std::endl;
+  std::cout << "  resumed: " << resumed << " handshakes, " <<
+    (resumed ? double(after.resumedms - before.resumedms) / resumed : 0) << " ms/op" << std::endl;
+}
+
+int main(int argc, char** argv) { return test::main(argc, argv); }